@@ -1,86 +1,138 @@
 #ifndef AVL_TREE_H
 #define AVL_TREE_H
 
-#include <vector>
-#include <memory>
+#include <algorithm>
 #include "Order.h"
+#include "ObjectPool.h"
 
+// Balanced tree of price levels. The lowest and highest levels are cached so the
+// best price on either side of the book is available in O(1). Nodes come from a
+// preallocated pool and are linked with plain pointers.
 class AVLTree {
-private:
+public:
+    struct Node;
+
+    // The part of a resting order that matching reads and writes, linked into the
+    // FIFO queue of its price level. The price is the level's; the fields matching
+    // never needs are kept apart (OrderDetails), so a sweep touches only these.
+    struct OrderEntry {
+        OrderId orderId;
+        OrderEntry* prev;
+        OrderEntry* next;
+        Node* level;       // Price level the entry is queued on
+        int quantity;      // Open quantity
+        char side;
+
+        OrderEntry(OrderId id, char side, int quantity)
+            : orderId(id), prev(nullptr), next(nullptr), level(nullptr), quantity(quantity), side(side) {}
+    };
+
     struct Node {
-    double price;                      // Price level
-    std::vector<Order> orders;        // Orders at this price level
-    std::shared_ptr<Node> left, right;
-    int height;
+        int64_t price;                     // Price level in ticks
+        OrderEntry* head;                  // Oldest order at this price level
+        OrderEntry* tail;                  // Newest order at this price level
+        int64_t quantity;                  // Open quantity of every order at this level
+        Node* left;
+        Node* right;
+        int height;
+
+        // Constructor with reordered initializer list
+        Node(int64_t p) : price(p), head(nullptr), tail(nullptr), quantity(0), left(nullptr), right(nullptr), height(1) {}
+
+        bool empty() const { return !head; }
+
+        // Appends the entry at the back of the queue
+        void append(OrderEntry* entry) {
+            quantity += entry->quantity;
+            entry->level = this;
+            entry->prev = tail;
+            entry->next = nullptr;
+            if (tail)
+                tail->next = entry;
+            else
+                head = entry;
+            tail = entry;
+        }
 
-    // Constructor with reordered initializer list
-    Node(double p) : price(p), orders(), left(nullptr), right(nullptr), height(1) {}
-};
+        // Unlinks the entry from anywhere in the queue in O(1). Callers that change a
+        // queued order's quantity adjust `quantity` by the same amount.
+        void unlink(OrderEntry* entry) {
+            quantity -= entry->quantity;
+            if (entry->prev)
+                entry->prev->next = entry->next;
+            else
+                head = entry->next;
+            if (entry->next)
+                entry->next->prev = entry->prev;
+            else
+                tail = entry->prev;
+            entry->prev = entry->next = nullptr;
+            entry->level = nullptr;
+        }
+    };
 
+    static_assert(sizeof(OrderEntry) == 40, "OrderEntry layout changed");
 
-    std::shared_ptr<Node> root;
+    using NodePool = ObjectPool<Node>;
+
+private:
+    NodePool& pool;     // Storage for price levels, possibly shared with other trees
+    Node* root;
+    Node* lowest;   // Cached lowest price level (best ask on the sell side)
+    Node* highest;  // Cached highest price level (best bid on the buy side)
 
-    int getHeight(std::shared_ptr<Node> node) {
+    int getHeight(Node* node) const {
         return node ? node->height : 0;
     }
 
-    int getBalance(std::shared_ptr<Node> node) {
+    int getBalance(Node* node) const {
         return node ? getHeight(node->left) - getHeight(node->right) : 0;
     }
 
-    std::shared_ptr<Node> rotateRight(std::shared_ptr<Node> y) {
+    void updateHeight(Node* node) {
+        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+    }
+
+    Node* rotateRight(Node* y) {
         auto x = y->left;
         auto T2 = x->right;
         x->right = y;
         y->left = T2;
 
-        y->height = 1 + std::max(getHeight(y->left), getHeight(y->right));
-        x->height = 1 + std::max(getHeight(x->left), getHeight(x->right));
+        updateHeight(y);
+        updateHeight(x);
         return x;
     }
 
-    std::shared_ptr<Node> rotateLeft(std::shared_ptr<Node> x) {
+    Node* rotateLeft(Node* x) {
         auto y = x->right;
         auto T2 = y->left;
         y->left = x;
         x->right = T2;
 
-        x->height = 1 + std::max(getHeight(x->left), getHeight(x->right));
-        y->height = 1 + std::max(getHeight(y->left), getHeight(y->right));
+        updateHeight(x);
+        updateHeight(y);
         return y;
     }
 
-    std::shared_ptr<Node> insertNode(std::shared_ptr<Node> node, double price, const Order& order) {
-        if (!node) {
-            auto newNode = std::make_shared<Node>(price);
-            newNode->orders.push_back(order);
-            return newNode;
-        }
-
-        if (price < node->price)
-            node->left = insertNode(node->left, price, order);
-        else if (price > node->price)
-            node->right = insertNode(node->right, price, order);
-        else
-            node->orders.push_back(order); // Same price level, add to the vector
-
-        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+    // Restores the AVL invariant at `node` after one of its subtrees changed height
+    Node* rebalance(Node* node) {
+        updateHeight(node);
 
         int balance = getBalance(node);
 
-        // Perform rotations if unbalanced
-        if (balance > 1 && price < node->left->price)
+        if (balance > 1 && getBalance(node->left) >= 0)
             return rotateRight(node);
 
-        if (balance < -1 && price > node->right->price)
-            return rotateLeft(node);
-
-        if (balance > 1 && price > node->left->price) {
+        if (balance > 1 && getBalance(node->left) < 0) {
             node->left = rotateLeft(node->left);
             return rotateRight(node);
         }
 
-        if (balance < -1 && price < node->right->price) {
+        if (balance < -1 && getBalance(node->right) <= 0)
+            return rotateLeft(node);
+
+        if (balance < -1 && getBalance(node->right) > 0) {
             node->right = rotateRight(node->right);
             return rotateLeft(node);
         }
@@ -88,14 +140,38 @@ private:
         return node;
     }
 
-    std::shared_ptr<Node> getMinValueNode(std::shared_ptr<Node> node) {
-        auto current = node;
-        while (current->left)
-            current = current->left;
-        return current;
+    Node* insertNode(Node* node, int64_t price, OrderEntry* entry, Node*& level) {
+        if (!node) {
+            Node* newNode = pool.create(price);
+            newNode->append(entry);
+            level = newNode;
+            return newNode;
+        }
+
+        if (price < node->price)
+            node->left = insertNode(node->left, price, entry, level);
+        else if (price > node->price)
+            node->right = insertNode(node->right, price, entry, level);
+        else {
+            node->append(entry); // Same price level, append to the queue
+            level = node;
+            return node;
+        }
+
+        return rebalance(node);
+    }
+
+    // Unlinks the lowest node of the subtree and hands it back through `min`
+    Node* detachMin(Node* node, Node*& min) {
+        if (!node->left) {
+            min = node;
+            return node->right;
+        }
+        node->left = detachMin(node->left, min);
+        return rebalance(node);
     }
 
-    std::shared_ptr<Node> deleteNode(std::shared_ptr<Node> node, double price) {
+    Node* deleteNode(Node* node, int64_t price) {
         if (!node)
             return node;
 
@@ -104,109 +180,130 @@ private:
         else if (price > node->price)
             node->right = deleteNode(node->right, price);
         else {
+            Node* removed = node;
             if (!node->left || !node->right) {
                 node = (node->left) ? node->left : node->right;
             } else {
-                auto temp = getMinValueNode(node->right);
-                node->price = temp->price;
-                node->orders = temp->orders;
-                node->right = deleteNode(node->right, temp->price);
+                // Splice the successor into this position instead of copying its
+                // contents, so pointers to surviving levels stay valid
+                Node* successor = nullptr;
+                Node* right = detachMin(node->right, successor);
+                successor->left = node->left;
+                successor->right = right;
+                node = successor;
             }
+            pool.destroy(removed);
         }
 
         if (!node)
             return node;
 
-        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
-
-        int balance = getBalance(node);
-
-        if (balance > 1 && getBalance(node->left) >= 0)
-            return rotateRight(node);
-
-        if (balance > 1 && getBalance(node->left) < 0) {
-            node->left = rotateLeft(node->left);
-            return rotateRight(node);
-        }
-
-        if (balance < -1 && getBalance(node->right) <= 0)
-            return rotateLeft(node);
-
-        if (balance < -1 && getBalance(node->right) > 0) {
-            node->right = rotateRight(node->right);
-            return rotateLeft(node);
-        }
+        return rebalance(node);
+    }
 
-        return node;
+    Node* leftmost() const {
+        Node* current = root;
+        while (current && current->left)
+            current = current->left;
+        return current;
     }
 
-    void findLowestHelper(std::shared_ptr<Node> node, double price, std::vector<Order>& result) const {
-        if (!node) return;
+    Node* rightmost() const {
+        Node* current = root;
+        while (current && current->right)
+            current = current->right;
+        return current;
+    }
 
-        if (node->price <= price) {
-            // Add all orders at this price
-            result.insert(result.end(), node->orders.begin(), node->orders.end());
-            // Check the left subtree for smaller prices
-            findLowestHelper(node->left, price, result);
-            // Check the right subtree for prices less than or equal to `price`
-            findLowestHelper(node->right, price, result);
-        } else {
-            // Only check the left subtree
-            findLowestHelper(node->left, price, result);
-        }
+    template <typename Fn>
+    static void visit(const Node* node, bool descending, Fn& fn) {
+        if (!node)
+            return;
+        visit(descending ? node->right : node->left, descending, fn);
+        fn(*node);
+        visit(descending ? node->left : node->right, descending, fn);
     }
 
-    void findHighestHelper(std::shared_ptr<Node> node, double price, std::vector<Order>& result) const {
-        if (!node) return;
+    // In-order visit that stops as soon as fn returns false; returns false if it stopped
+    template <typename Fn>
+    static bool visitWhile(const Node* node, bool descending, Fn& fn) {
+        if (!node)
+            return true;
+        return visitWhile(descending ? node->right : node->left, descending, fn) && fn(*node) &&
+               visitWhile(descending ? node->left : node->right, descending, fn);
+    }
 
-        if (node->price >= price) {
-            // Add all orders at this price
-            result.insert(result.end(), node->orders.begin(), node->orders.end());
-            // Check the right subtree for larger prices
-            findHighestHelper(node->right, price, result);
-            // Check the left subtree for prices greater than or equal to `price`
-            findHighestHelper(node->left, price, result);
-        } else {
-            // Only check the right subtree
-            findHighestHelper(node->right, price, result);
-        }
+    void destroyAll(Node* node) {
+        if (!node)
+            return;
+        destroyAll(node->left);
+        destroyAll(node->right);
+        pool.destroy(node);
     }
 
 public:
-    AVLTree() : root(nullptr) {}
+    explicit AVLTree(NodePool& pool) : pool(pool), root(nullptr), lowest(nullptr), highest(nullptr) {}
+
+    // Returns every level to the pool; the order entries are owned elsewhere
+    ~AVLTree() { destroyAll(root); }
 
-    void insert(double price, const Order& order) {
-        root = insertNode(root, price, order);
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+
+    // Appends the entry to the queue at `price`, creating the level if needed.
+    // The tree links the entry but does not own it.
+    Node* insert(int64_t price, OrderEntry* entry) {
+        Node* level = nullptr;
+        root = insertNode(root, price, entry, level);
+
+        if (!lowest || price < lowest->price)
+            lowest = level;
+        if (!highest || price > highest->price)
+            highest = level;
+        return level;
     }
 
-    void remove(double price) {
+    // Removes the whole price level; its queue must already be empty
+    void remove(int64_t price) {
+        bool wasLowest = lowest && lowest->price == price;
+        bool wasHighest = highest && highest->price == price;
+
         root = deleteNode(root, price);
+
+        if (wasLowest)
+            lowest = leftmost();
+        if (wasHighest)
+            highest = rightmost();
     }
 
-    std::vector<Order> find(double price) {
-        auto current = root;
+    Node* find(int64_t price) const {
+        Node* current = root;
         while (current) {
             if (price < current->price)
                 current = current->left;
             else if (price > current->price)
                 current = current->right;
             else
-                return current->orders;
+                return current;
         }
-        return {};
+        return nullptr;
     }
 
-    std::vector<Order> findLowestLessThanEqual(double price) const {
-        std::vector<Order> result;
-        findLowestHelper(root, price, result);
-        return result;
+    // Calls fn(const Node&) for every level in price order, highest first if `descending`
+    template <typename Fn>
+    void forEachLevel(bool descending, Fn fn) const {
+        visit(root, descending, fn);
     }
 
-    std::vector<Order> findHighestGreaterThanEqual(double price) const {
-        std::vector<Order> result;
-        findHighestHelper(root, price, result);
-        return result;
+    // Like forEachLevel, but stops at the first level for which fn(const Node&) returns false
+    template <typename Fn>
+    void forEachLevelWhile(bool descending, Fn fn) const {
+        visitWhile(root, descending, fn);
     }
+
+    Node* lowestLevel() const { return lowest; }
+    Node* highestLevel() const { return highest; }
+    bool empty() const { return !root; }
 };
 
 #endif // AVL_TREE_H
@@ -0,0 +1,361 @@
+// Microbenchmarks for the book, the engine, the text parser and the shared-memory transport. Every workload is
+// generated from a fixed seed, so two runs on the same build see identical input.
+//
+// Build and run with `make bench`; `bin/benchmark --ops <n>` changes the number of
+// timed operations per workload, `--filter <text>` runs only matching workloads.
+// The book workloads run twice: book_* on the AVL tree, ladder_* on the dense
+// price ladder, for a side-by-side comparison.
+// Each operation is timed on its own, so every figure includes one clock read;
+// the timer_overhead row shows how much that is.
+
+#include "AVLTree.h"
+#include "OrderBook.h"
+#include "MatchingEngine.h"
+#include "RiskLimits.h"
+#include "NetworkInterface.h"
+#include "ShmTransport.h"
+#include "ShmClient.h"
+#include "SymbolDirectory.h"
+#include "Logger.h"
+#include "Stats.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Heap allocations made by the timed region; operator new below counts them
+size_t allocations = 0;
+
+// Deterministic xorshift generator
+class Rng {
+private:
+    uint64_t state;
+
+public:
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Uniform in [low, high]
+    int64_t between(int64_t low, int64_t high) {
+        return low + static_cast<int64_t>(next() % static_cast<uint64_t>(high - low + 1));
+    }
+};
+
+struct Config {
+    size_t ops = 200000;
+    std::string filter;   // Empty: run everything
+};
+
+// Times `ops` calls of op(i), one timestamp pair per call, and prints ns/op,
+// allocations/op and percentiles. `setup(i)` runs before each op outside the timing.
+// A workload excluded by --filter still runs, untimed, because the next workload
+// starts from the book it leaves behind.
+template <typename Setup, typename Op>
+void run(const Config& config, const char* name, Setup setup, Op op) {
+    if (!config.filter.empty() && std::string(name).find(config.filter) == std::string::npos) {
+        for (size_t i = 0; i < config.ops; ++i) {
+            setup(i);
+            op(i);
+        }
+        return;
+    }
+
+    LatencyHistogram histogram;
+    uint64_t timedNs = 0;
+    size_t timedAllocations = 0;
+    for (size_t i = 0; i < config.ops; ++i) {
+        setup(i);
+        size_t allocationsBefore = allocations;
+        uint64_t start = nowNs();
+        op(i);
+        uint64_t elapsed = nowNs() - start;
+        timedAllocations += allocations - allocationsBefore;
+        timedNs += elapsed;
+        histogram.record(elapsed);
+    }
+
+    std::printf("%-30s %10.1f %10.3f %8llu %8llu %8llu %10llu\n", name,
+                static_cast<double>(timedNs) / config.ops,
+                static_cast<double>(timedAllocations) / config.ops,
+                static_cast<unsigned long long>(histogram.percentile(0.50)),
+                static_cast<unsigned long long>(histogram.percentile(0.99)),
+                static_cast<unsigned long long>(histogram.percentile(0.999)),
+                static_cast<unsigned long long>(histogram.percentile(1.0)));
+}
+
+void noSetup(size_t) {}
+
+BookCapacity capacityFor(size_t orders) {
+    BookCapacity capacity;
+    capacity.maxOrders = orders;
+    capacity.maxLevels = orders;
+    return capacity;
+}
+
+// Tree operations in isolation: many distinct levels vs. a handful of deep ones
+void benchAvlTree(const Config& config) {
+    const size_t n = config.ops;
+    AVLTree::NodePool nodes(n);
+    ObjectPool<AVLTree::OrderEntry> entries(n);
+    std::vector<AVLTree::OrderEntry*> created(n);
+    for (size_t i = 0; i < n; ++i) {
+        created[i] = entries.create(static_cast<OrderId>(i + 1), 'S', 1);
+    }
+
+    // Distinct prices in shuffled order, so every insert creates a level
+    std::vector<int64_t> prices(n);
+    for (size_t i = 0; i < n; ++i) {
+        prices[i] = static_cast<int64_t>(i) + 1;
+    }
+    Rng rng(1);
+    for (size_t i = n; i > 1; --i) {
+        std::swap(prices[i - 1], prices[rng.next() % i]);
+    }
+
+    {
+        AVLTree tree(nodes);
+        run(config, "avl_insert_many_levels", noSetup, [&](size_t i) { tree.insert(prices[i], created[i]); });
+        run(config, "avl_find_many_levels", noSetup, [&](size_t i) {
+            AVLTree::Node* volatile level = tree.find(prices[(i * 7919) % n]);
+            (void)level;
+        });
+        run(config, "avl_best_level", noSetup, [&](size_t) {
+            AVLTree::Node* volatile level = tree.lowestLevel();
+            (void)level;
+        });
+        run(config, "avl_remove_many_levels", [&](size_t i) { tree.find(prices[i])->unlink(created[i]); },
+            [&](size_t i) { tree.remove(prices[i]); });
+    }
+
+    {
+        // 16 levels: all but the first insert per level append to an existing queue
+        AVLTree tree(nodes);
+        run(config, "avl_insert_few_levels", noSetup, [&](size_t i) { tree.insert(prices[i] % 16, created[i]); });
+    }
+}
+
+// Resting orders: insert-heavy, cancel-heavy, and sweeps through deep and shallow
+// books. Runs once per level backend; every price stays within `ladder`.
+void benchOrderBook(const Config& config, const std::string& prefix, const LadderConfig& ladder) {
+    const size_t n = config.ops;
+    std::vector<Fill> fills;
+    fills.reserve(1024);
+    auto named = [&prefix](const char* workload) { return prefix + workload; };
+
+    {
+        // Bids and asks that never cross, spread over 1000 levels per side
+        BookMemory memory(capacityFor(n));
+        OrderBook book(memory, 0, ladder);
+        Rng rng(2);
+        run(config, named("_add_no_cross").c_str(), noSetup, [&](size_t i) {
+            bool buy = rng.next() & 1;
+            int64_t price = buy ? rng.between(9000, 9999) : rng.between(10001, 11000);
+            book.addOrder(Order(static_cast<OrderId>(i + 1), buy ? 'B' : 'S', price, 10, 0, 0));
+        });
+
+        // Cancel every order in a shuffled sequence, so cancels hit all queue positions
+        std::vector<OrderId> ids(n);
+        for (size_t i = 0; i < n; ++i) {
+            ids[i] = static_cast<OrderId>(i + 1);
+        }
+        for (size_t i = n; i > 1; --i) {
+            std::swap(ids[i - 1], ids[rng.next() % i]);
+        }
+        run(config, named("_cancel_random").c_str(), noSetup, [&](size_t i) { book.cancelOrder(ids[i]); });
+    }
+
+    // One ask per level; each buy sweeps `depth` levels. Whenever the book runs
+    // low it is rebuilt outside the timing, starting again from the same price.
+    auto sweep = [&](const char* name, int depth) {
+        BookMemory memory(capacityFor(4096 + depth));
+        std::unique_ptr<OrderBook> book;
+        OrderId nextId = 1;
+        int64_t nextPrice = 0;
+        int resting = 0;
+        auto setup = [&](size_t) {
+            if (resting < depth) {
+                book.reset();
+                book = std::make_unique<OrderBook>(memory, 0, ladder);
+                for (nextPrice = 10000, resting = 0; resting < 4096; ++resting) {
+                    book->addOrder(Order(nextId++, 'S', nextPrice++, 1, 0, 0));
+                }
+            }
+            fills.clear();
+        };
+        run(config, named(name).c_str(), setup, [&](size_t) {
+            Order buy(nextId++, 'B', nextPrice, depth, 0, 0);
+            book->matchOrder(buy, fills);
+            resting -= depth;
+        });
+    };
+    sweep("_match_1_level", 1);
+    sweep("_match_sweep_10_levels", 10);
+    sweep("_match_sweep_100_levels", 100);
+
+    {
+        // Few levels, long queues: each buy takes one order off the front of the best level
+        BookMemory memory(capacityFor(n + 1));
+        OrderBook book(memory, 0, ladder);
+        for (size_t i = 0; i < n; ++i) {
+            book.addOrder(Order(static_cast<OrderId>(i + 1), 'S', 10000 + static_cast<int64_t>(i % 4), 1, 0, 0));
+        }
+        OrderId nextId = static_cast<OrderId>(n) + 1;
+        run(config, named("_match_deep_queue").c_str(), [&](size_t) { fills.clear(); }, [&](size_t) {
+            Order buy(nextId++, 'B', 10003, 1, 0, 0);
+            book.matchOrder(buy, fills);
+        });
+    }
+
+    {
+        // Fill-or-kill check that needs 100 of 1000 ask levels; nothing trades
+        BookMemory memory(capacityFor(1000));
+        OrderBook book(memory, 0, ladder);
+        for (int i = 0; i < 1000; ++i) {
+            book.addOrder(Order(i + 1, 'S', 10000 + i, 1, 0, 0));
+        }
+        volatile int64_t available = 0;
+        run(config, named("_fok_check_100_levels").c_str(), noSetup,
+            [&](size_t) { available = book.crossableQuantity('B', 10999, 100); });
+        (void)available;
+    }
+}
+
+// Full new-order path: duplicate check, match, rest and the (disabled) logging.
+// The _risk run adds the pre-trade checks, under limits no order reaches.
+void benchMatchingEngine(const Config& config) {
+    const std::string limitsFile = "/tmp/matching_bench." + std::to_string(getpid()) + ".risk";
+    {
+        std::FILE* file = std::fopen(limitsFile.c_str(), "w");
+        std::fputs("default max-qty=1000000 max-notional=1e12 max-position=1000000000 band-bps=10000\n", file);
+        std::fclose(file);
+    }
+    RiskLimits limits(limitsFile, 64);
+    std::remove(limitsFile.c_str());
+
+    for (bool withRisk : {false, true}) {
+        MatchingEngine engine(capacityFor(config.ops + 1));
+        if (withRisk) {
+            engine.enableRisk(limits, {0.01});
+        }
+        ExecutionReport report;
+        Rng rng(3);
+
+        // Prices random-walk around a mid so roughly half the orders cross
+        run(config, withRisk ? "engine_process_order_risk" : "engine_process_order_mixed",
+            [&](size_t) { report.clear(); }, [&](size_t i) {
+                bool buy = rng.next() & 1;
+                int64_t price = 10000 + rng.between(-20, 20);
+                engine.processOrder(Order(static_cast<OrderId>(i + 1), buy ? 'B' : 'S', price,
+                                          static_cast<int>(rng.between(1, 100)), 0,
+                                          static_cast<int>(i % 64)), report);
+            });
+    }
+}
+
+// Text order parsing, including validation and tick conversion
+void benchParser(const Config& config) {
+    SymbolDirectory symbols = SymbolDirectory::singleInstrument();
+    NetworkInterface network(0, symbols);  // Port 0: any free port, never read
+
+    std::vector<std::string> messages(1024);
+    Rng rng(4);
+    for (size_t i = 0; i < messages.size(); ++i) {
+        char text[96];
+        std::snprintf(text, sizeof(text), "%zu %c %lld.%02lld %lld 169348127 2001 0", i + 1,
+                      (rng.next() & 1) ? 'B' : 'S', static_cast<long long>(rng.between(90, 110)),
+                      static_cast<long long>(rng.between(0, 99)), static_cast<long long>(rng.between(1, 1000)));
+        messages[i] = text;
+    }
+
+    run(config, "parse_order_text", noSetup, [&](size_t i) {
+        Order order = network.parseOrder(messages[i % messages.size()]);
+        (void)order;
+    });
+}
+
+// A binary IOC order through a shared-memory channel and back, with client and
+// engine on this one thread: the transport's own cost, without the cache-line
+// transfers between cores that a real round trip adds
+void benchShmRoundTrip(const Config& config) {
+    SymbolDirectory symbols = SymbolDirectory::singleInstrument();
+    NetworkInterface network(0, symbols);
+    MatchingEngine engine(capacityFor(16));
+    const std::string prefix = "matching_bench." + std::to_string(getpid());
+    ShmTransport transport(network, prefix, 1, 256);
+    ShmClient client(prefix);
+
+    WireNewOrder order{};
+    order.header.magic = PROTOCOL_MAGIC;
+    order.header.version = PROTOCOL_VERSION;
+    order.header.type = static_cast<uint8_t>(WireType::NewOrder);
+    order.price = 10000;
+    order.quantity = 1;
+    order.side = 'B';
+    order.timeInForce = static_cast<uint8_t>(TimeInForce::IOC);  // Nothing to trade, nothing rests
+    char reply[ShmClient::MAX_REPLY];
+
+    run(config, "shm_roundtrip_ioc", noSetup, [&](size_t i) {
+        order.header.sequence = i + 1;
+        order.orderId = static_cast<OrderId>(i + 1);
+        client.trySend(&order, sizeof(order));
+        transport.poll(engine);
+        client.tryReceive(reply, sizeof(reply));
+    });
+}
+
+} // namespace
+
+// Counting replacements for the global allocation functions
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ops" && i + 1 < argc) {
+            config.ops = std::stoul(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--ops <n>] [--filter <text>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (config.ops == 0) {
+        std::fprintf(stderr, "--ops must be greater than zero\n");
+        return 1;
+    }
+
+    // Measure the code paths, not the log writer
+    Logger::getInstance().setLevel(LogLevel::Off);
+
+    std::printf("%-30s %10s %10s %8s %8s %8s %10s\n", "workload", "ns/op", "allocs/op",
+                "p50", "p99", "p99.9", "max");
+    run(config, "timer_overhead", noSetup, [](size_t) {});
+    benchAvlTree(config);
+    benchOrderBook(config, "book", LadderConfig());                  // AVL tree only
+    benchOrderBook(config, "ladder", LadderConfig{10000 - 8192, 16384}); // Dense array around 10000
+    benchMatchingEngine(config);
+    benchParser(config);
+    benchShmRoundTrip(config);
+    return 0;
+}
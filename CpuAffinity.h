@@ -0,0 +1,72 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <chrono>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+
+// Idle polling loops spin this many times before they start yielding the CPU
+constexpr int SPINS_BEFORE_YIELD = 1024;
+
+// Pins the calling thread to one CPU. Returns false if the core does not exist
+// or the affinity could not be set; the thread then keeps running unpinned.
+inline bool pinCurrentThread(int core) {
+    if (core < 0 || core >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Moves the calling thread to SCHED_FIFO at `priority` (1-99). Returns false if
+// that is not permitted (it needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance);
+// the thread then keeps the normal scheduler. A spinning realtime thread can
+// starve everything else on its core, so only use it on pinned, isolated cores.
+inline bool setRealtimePriority(int priority) {
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+// Pins the calling thread to `core` (if not -1) and raises it to realtime
+// `rtPriority` (if not 0). Returns a description of the outcome for the log.
+inline std::string placeCurrentThread(int core, int rtPriority) {
+    std::string placement;
+    if (core < 0) {
+        placement = "unpinned";
+    } else if (pinCurrentThread(core)) {
+        placement = "pinned to core " + std::to_string(core);
+    } else {
+        placement = "failed to pin to core " + std::to_string(core);
+    }
+    if (rtPriority > 0) {
+        placement += setRealtimePriority(rtPriority) ? ", SCHED_FIFO " + std::to_string(rtPriority)
+                                                     : ", failed to set SCHED_FIFO " + std::to_string(rtPriority);
+    }
+    return placement;
+}
+
+// Tells the CPU this is a spin-wait loop
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Nanoseconds one cpuRelax() takes on this machine, averaged over `spins`. It
+// varies widely between CPU generations (PAUSE is ~10 cycles on some, ~140 on others).
+inline double measureSpinNs(int spins = 100000) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < spins; ++i) {
+        cpuRelax();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / spins;
+}
+
+#endif // CPU_AFFINITY_H
@@ -0,0 +1,42 @@
+#ifndef EXECUTION_H
+#define EXECUTION_H
+
+#include "Order.h"
+#include <cstdint>
+#include <vector>
+
+// One trade between an incoming order (taker) and a resting order (maker)
+struct Fill {
+    OrderId takerId;
+    OrderId makerId;
+    int64_t price;        // Ticks; always the maker's price
+    int quantity;
+    int takerRemaining;   // Taker quantity still open after this fill
+    int makerRemaining;   // Maker quantity still resting after this fill, 0 if removed
+    int makerTraderId;    // Set only when the matcher was asked for it; fits in what was padding
+};
+
+// What the engine did with one request. The caller keeps one report and passes it
+// to every call, so the fill buffer grows to its working size once and is then
+// reused without allocating.
+struct ExecutionReport {
+    std::vector<Fill> fills;  // In execution order
+    OrderId orderId = 0;
+    int openQuantity = 0;     // Left resting on the book once the request is done
+    int cancelledQuantity = 0; // Not filled and not rested: IOC and market remainders, killed FOK orders
+    char side = 0;            // Side of the order once it reached the book; 0 if it did not
+    bool queued = false;      // Handed to another thread; fills and open quantity are not known
+
+    explicit ExecutionReport(size_t expectedFills = 64) { fills.reserve(expectedFills); }
+
+    void clear() {
+        fills.clear();
+        orderId = 0;
+        openQuantity = 0;
+        cancelledQuantity = 0;
+        side = 0;
+        queued = false;
+    }
+};
+
+#endif // EXECUTION_H
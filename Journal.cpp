@@ -0,0 +1,187 @@
+#include "Journal.h"
+#include "Logger.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t PAGE_SIZE = 4096;
+
+std::runtime_error journalError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " journal " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+Journal::Journal(const std::string& path, size_t sizeBytes, bool syncOnCommit)
+    : fd(-1), base(nullptr), mappedBytes(0), capacity(0), used(0), committed(0),
+      syncOnCommit(syncOnCommit), path(path) {
+    if (sizeBytes < HEADER_SIZE + sizeof(JournalRecord)) {
+        throw std::invalid_argument("Journal size is too small.");
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw journalError("Failed to open", path);
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        throw journalError("Failed to stat", path);
+    }
+    const bool created = info.st_size == 0;
+
+    // Reserve the blocks up front so appends never fail on a full disk; fall back
+    // to a sparse file where the filesystem cannot preallocate
+    mappedBytes = std::max(static_cast<size_t>(info.st_size), sizeBytes);
+    mappedBytes = (mappedBytes - HEADER_SIZE) / sizeof(JournalRecord) * sizeof(JournalRecord) + HEADER_SIZE;
+    if (mappedBytes > static_cast<size_t>(info.st_size)) {
+        int err = posix_fallocate(fd, 0, static_cast<off_t>(mappedBytes));
+        if (err != 0 && ftruncate(fd, static_cast<off_t>(mappedBytes)) < 0) {
+            close(fd);
+            throw journalError("Failed to size", path);
+        }
+    }
+
+    void* memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (memory == MAP_FAILED) {
+        close(fd);
+        throw journalError("Failed to map", path);
+    }
+    base = static_cast<char*>(memory);
+    capacity = (mappedBytes - HEADER_SIZE) / sizeof(JournalRecord);
+
+    Header header;
+    if (created) {
+        header = Header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.recordSize = sizeof(JournalRecord);
+        std::memcpy(base, &header, sizeof(header));
+        msync(base, PAGE_SIZE, MS_SYNC);
+    } else {
+        std::memcpy(&header, base, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION || header.recordSize != sizeof(JournalRecord)) {
+            munmap(base, mappedBytes);
+            close(fd);
+            throw std::runtime_error("Not a version " + std::to_string(VERSION) + " journal: " + path);
+        }
+    }
+}
+
+Journal::~Journal() {
+    if (base) {
+        commit();
+        munmap(base, mappedBytes);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// FNV-1a over the record up to its checksum field
+uint32_t Journal::checksum(const JournalRecord& record) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(JournalRecord, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Replays until the first slot that does not hold the next record: a zeroed slot
+// past the end, or one torn by a crash mid-write. Appends resume from that slot.
+size_t Journal::replay(OrderHandler& engine, uint64_t after) {
+    Logger& logger = Logger::getInstance();
+    const LogLevel level = logger.getLevel();
+    logger.setLevel(LogLevel::Off);
+
+    auto start = std::chrono::steady_clock::now();
+    ExecutionReport report;
+    const JournalRecord* record = records();
+    size_t count = 0;
+    size_t replayed = 0;
+    while (count < capacity && record[count].sequence == count + 1 &&
+           record[count].checksum == checksum(record[count])) {
+        const JournalRecord& r = record[count];
+        if (r.sequence > after && !(r.flags & JOURNAL_DISCARDED)) {
+            Order order(r.orderId, r.side, r.price, r.quantity, r.timestamp, r.traderId, r.isMarketOrder != 0,
+                        r.symbolId, static_cast<TimeInForce>(r.timeInForce));
+            engine.replayMessage(OrderMessage(static_cast<MessageType>(r.type), order, r.clientSequence), report);
+            ++replayed;
+        }
+        ++count;
+    }
+    if (count < after) {
+        logger.setLevel(level);
+        throw std::runtime_error("Journal " + path + " ends at record " + std::to_string(count) +
+                                 ", before snapshot " + std::to_string(after));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    logger.setLevel(level);
+    used = committed = count;
+    logger.log("Replayed " + std::to_string(replayed) + " of " + std::to_string(count) + " journal records from " +
+               path + " in " + std::to_string(elapsed) + " ms");
+    return replayed;
+}
+
+void Journal::append(const OrderMessage& message) {
+    if (used == capacity) {
+        throw std::runtime_error("Journal full");
+    }
+
+    JournalRecord record{};
+    record.sequence = used + 1;
+    record.clientSequence = message.sequence;
+    record.price = message.order.price;
+    record.symbolId = message.order.symbolId;
+    record.orderId = message.order.orderId;
+    record.quantity = message.order.quantity;
+    record.timestamp = message.order.timestamp;
+    record.traderId = message.order.traderId;
+    record.type = static_cast<uint8_t>(message.type);
+    record.side = message.order.side;
+    record.isMarketOrder = message.order.isMarketOrder ? 1 : 0;
+    record.timeInForce = static_cast<uint8_t>(message.order.timeInForce);
+    record.checksum = checksum(record);
+
+    std::memcpy(&records()[used], &record, sizeof(record));
+    ++used;
+    relaxedAdd(appended, 1);
+}
+
+// A crash between the two stores leaves a torn last record, which replay stops before
+void Journal::discardLast() {
+    if (used == 0) {
+        return;
+    }
+    JournalRecord& record = records()[used - 1];
+    record.flags |= JOURNAL_DISCARDED;
+    record.checksum = checksum(record);
+}
+
+void Journal::commit() {
+    if (!syncOnCommit || committed == used) {
+        return;
+    }
+    // msync needs a page-aligned start; the range ends with the last record written
+    size_t begin = (HEADER_SIZE + committed * sizeof(JournalRecord)) / PAGE_SIZE * PAGE_SIZE;
+    size_t end = HEADER_SIZE + used * sizeof(JournalRecord);
+    if (msync(base + begin, end - begin, MS_SYNC) < 0) {
+        Logger::getInstance().log("Error: Failed to sync journal " + path, LogLevel::Error);
+        return;
+    }
+    committed = used;
+}
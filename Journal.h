@@ -0,0 +1,164 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Message.h"
+#include "Logger.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One journaled request. Records are 64 bytes and start on a 64-byte boundary, so
+// none straddles a page and a crash can tear at most the record being written;
+// the checksum catches that on replay.
+struct JournalRecord {
+    uint64_t sequence;        // Journal position, 1-based and consecutive
+    uint64_t clientSequence;  // OrderMessage::sequence
+    int64_t price;            // Ticks
+    int64_t orderId;
+    int64_t timestamp;
+    uint32_t symbolId;
+    int32_t quantity;
+    int32_t traderId;
+    uint8_t type;             // MessageType
+    char side;
+    uint8_t isMarketOrder;
+    uint8_t timeInForce;      // TimeInForce
+    uint8_t flags;            // JOURNAL_DISCARDED
+    uint8_t reserved[3];
+    uint32_t checksum;        // Over every byte above
+};
+
+static_assert(sizeof(JournalRecord) == 64, "JournalRecord layout changed");
+
+// Set on a record the engine rejected before matching it; replay skips it
+constexpr uint8_t JOURNAL_DISCARDED = 1;
+
+// Append-only write-ahead log of the requests handed to the engine. The file is
+// preallocated and memory-mapped; append() is a 64-byte copy into the mapping.
+// Because matching is deterministic, feeding the records back through a fresh
+// engine in order rebuilds every book exactly.
+//
+// Writes to a shared mapping survive a crash of the process as soon as append()
+// returns. With `syncOnCommit`, commit() also forces them to disk (msync), so a
+// reply sent after commit() survives power loss. Not thread-safe: one thread
+// appends and commits.
+class Journal {
+private:
+    static constexpr uint64_t MAGIC = 0x314C4E524A534D4Full;  // "OMSJRNL1"
+    static constexpr uint32_t VERSION = 2;   // 2: 64-bit order IDs and timestamps
+    static constexpr size_t HEADER_SIZE = 64;
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t recordSize;
+        uint8_t reserved[48];
+    };
+
+    int fd;
+    char* base;              // Start of the mapping: the header, then the records
+    size_t mappedBytes;
+    size_t capacity;         // Records that fit in the file
+    size_t used;             // Records written
+    size_t committed;        // Records forced to disk
+    bool syncOnCommit;
+    std::string path;
+    std::atomic<uint64_t> appended{0};  // For statsReport(); written by the appending thread
+
+    JournalRecord* records() const { return reinterpret_cast<JournalRecord*>(base + HEADER_SIZE); }
+
+    static uint32_t checksum(const JournalRecord& record);
+
+public:
+    // Opens or creates the journal at `path`, growing it to at least `sizeBytes`.
+    // Throws std::runtime_error if it cannot be mapped or is not a journal.
+    Journal(const std::string& path, size_t sizeBytes, bool syncOnCommit);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Applies every intact record after sequence `after` (the books were loaded
+    // from a snapshot taken there) to `engine` in order with logging turned off,
+    // and positions the journal after the last one. Call once, before append().
+    // Returns the number of records replayed.
+    size_t replay(OrderHandler& engine, uint64_t after = 0);
+
+    // Writes the request at the end of the journal. Throws std::runtime_error
+    // when the file is full, so the request is rejected rather than lost.
+    void append(const OrderMessage& message);
+
+    // Flags the last record appended as discarded, for a request the handler
+    // rejected, so replay does not apply it
+    void discardLast();
+
+    // Forces everything appended so far to disk (group commit). A no-op without syncOnCommit.
+    void commit();
+
+    size_t size() const { return used; }
+    size_t maxRecords() const { return capacity; }
+    uint64_t appendedRecords() const { return appended.load(std::memory_order_relaxed); }
+};
+
+// Journals each request before passing it on, and commits the journal when the
+// front end is about to reply. A request the handler rejects is discarded from the
+// journal: a rejection leaves the books untouched, and replay may not reject it
+// again (it skips risk checks, and a sharded engine waits out a full queue
+// instead of refusing). Snapshot requests are not journaled; they are
+// stamped with the journal position and passed on, and with `snapshotEvery`
+// one is also issued after every that many records.
+class JournaledHandler : public OrderHandler {
+private:
+    OrderHandler& engine;
+    Journal& journal;
+    size_t snapshotEvery;       // 0: only on request
+    size_t lastSnapshot;        // Journal position of the last snapshot issued
+    ExecutionReport snapshotReport;
+
+    void snapshot(ExecutionReport& report) {
+        lastSnapshot = journal.size();
+        engine.processMessage(OrderMessage(MessageType::Snapshot, Order(), lastSnapshot), report);
+    }
+
+public:
+    JournaledHandler(OrderHandler& engine, Journal& journal, size_t snapshotEvery = 0)
+        : engine(engine), journal(journal), snapshotEvery(snapshotEvery), lastSnapshot(journal.size()),
+          snapshotReport(0) {}
+
+    void processMessage(const OrderMessage& message, ExecutionReport& report) override {
+        if (message.type == MessageType::Snapshot) {
+            snapshot(report);
+            return;
+        }
+
+        journal.append(message);
+        try {
+            engine.processMessage(message, report);
+        } catch (const std::exception&) {
+            journal.discardLast();
+            throw;
+        }
+
+        if (snapshotEvery && journal.size() - lastSnapshot >= snapshotEvery) {
+            try {
+                snapshot(snapshotReport);
+            } catch (const std::exception& e) {
+                Logger::getInstance().log(std::string("Periodic snapshot skipped: ") + e.what(), LogLevel::Warn);
+            }
+        }
+    }
+
+    void commit() override {
+        journal.commit();
+        engine.commit();
+    }
+
+    // The engine's report and a "journal:" line with the records written and room left
+    std::string statsReport() const override {
+        return engine.statsReport() + "journal: appended=" + std::to_string(journal.appendedRecords()) +
+               " capacity=" + std::to_string(journal.maxRecords()) + "\n";
+    }
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,476 @@
+// Open-loop load generator for the UDP order entry port. Each thread sends binary
+// requests on a fixed schedule from its own socket, whether or not earlier ones
+// have been answered, and matches every reply to its request by the echoed
+// sequence number and order ID. Latency is measured from the time a request was
+// due to be sent, not when it went out, so time the generator itself spent
+// waiting counts against the engine (correcting for coordinated omission); the
+// service histogram, from the actual send, is reported alongside for contrast.
+// Raise --rate until the response percentiles climb away from the service ones:
+// that is where the engine saturates.
+//
+// Build with `make`, then for example:
+//   bin/loadgen --port 8080 --rate 200000 --threads 2 --duration 10 --mix add=70,cancel=20,market=10
+//
+// Options: --host <ip> --port <n> --rate <requests/s> --threads <n> --duration <s>
+// --mix add=<w>,ioc=<w>,market=<w>,cancel=<w>,replace=<w> --symbols <n> --price-mid <ticks>
+// --price-width <ticks> --price-dist <uniform|normal> --max-qty <n> --trader <id>
+// --cores <c0,c1,...> --timeout-ms <ms> --window <requests>
+// Symbol IDs 0 to --symbols - 1 must exist in the engine's symbol file.
+
+#include "Protocol.h"
+#include "Stats.h"
+#include "CpuAffinity.h"
+#include "Order.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+enum RequestKind { Add, Ioc, Market, Cancel, Replace, KINDS };
+const char* const KIND_NAMES[KINDS] = {"add", "ioc", "market", "cancel", "replace"};
+
+struct Config {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    double rate = 10000;            // Requests per second, over every thread
+    size_t threads = 1;
+    double duration = 10;           // Seconds of sending; replies are awaited for up to timeoutMs after
+    double mix[KINDS] = {70, 0, 10, 20, 0};  // Relative weights
+    uint32_t symbols = 1;
+    int64_t priceMid = 10000;       // Ticks
+    int64_t priceWidth = 20;        // Ticks: half-range (uniform) or two standard deviations (normal)
+    bool normalPrices = false;
+    int maxQuantity = 100;
+    int traderId = 1;
+    std::vector<int> cores;
+    uint64_t timeoutMs = 1000;
+    size_t window = 1 << 16;        // Requests in flight per thread; older ones count as lost
+};
+
+// One request awaiting its reply
+struct Pending {
+    uint64_t sequence = 0;          // 0: free
+    uint64_t intended = 0;          // When the schedule said to send it
+    uint64_t sent = 0;              // When it was sent
+    int64_t orderId = 0;
+};
+
+// A day order this thread entered, which may still be resting
+struct Resting {
+    int64_t orderId = 0;            // 0: empty
+    uint32_t symbolId = 0;
+};
+
+// Counters read by the progress line while the worker runs
+struct WorkerStats {
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> acked{0};
+    std::atomic<uint64_t> rejected{0};     // Acked with accepted = 0
+    std::atomic<uint64_t> lost{0};         // Never answered, or answered after the window moved on
+    std::atomic<uint64_t> unmatched{0};    // Replies to no request in flight
+    std::atomic<uint64_t> sendErrors{0};
+    std::atomic<uint64_t> byKind[KINDS] = {};
+};
+
+class Worker {
+private:
+    const Config& config;
+    size_t index;
+    int fd = -1;
+    std::mt19937_64 rng;
+    std::discrete_distribution<int> kinds;
+    std::vector<Pending> pending;       // By sequence & mask
+    size_t mask;
+    std::vector<Resting> resting;       // Recent day orders, candidates for cancel and replace
+    size_t restingNext = 0;
+    uint64_t sequence = 0;
+    int64_t nextOrderId;
+    size_t outstanding = 0;
+
+public:
+    LatencyHistogram response;          // From the intended send time
+    LatencyHistogram service;           // From the actual send time
+    WorkerStats stats;
+
+    Worker(const Config& config, size_t index, const sockaddr_in& server, int64_t idBase)
+        : config(config), index(index), rng(0x9E3779B97F4A7C15ull * (index + 1)),
+          kinds(config.mix, config.mix + KINDS), mask(1), resting(4096) {
+        while (mask < config.window) {
+            mask <<= 1;
+        }
+        pending.resize(mask);
+        mask -= 1;
+        nextOrderId = idBase | (static_cast<int64_t>(index) << 40);
+
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&server), sizeof(server)) < 0) {
+            throw std::runtime_error("Failed to open a socket to the engine");
+        }
+        int buffer = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    }
+
+    ~Worker() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int64_t price() {
+        if (config.normalPrices) {
+            std::normal_distribution<double> normal(static_cast<double>(config.priceMid), config.priceWidth / 2.0);
+            return std::max<int64_t>(1, std::llround(normal(rng)));
+        }
+        std::uniform_int_distribution<int64_t> uniform(config.priceMid - config.priceWidth,
+                                                       config.priceMid + config.priceWidth);
+        return std::max<int64_t>(1, uniform(rng));
+    }
+
+    // A resting candidate, taken out of the pool; order ID 0 if the slot drawn is empty
+    Resting takeResting() {
+        size_t slot = std::uniform_int_distribution<size_t>(0, resting.size() - 1)(rng);
+        Resting order = resting[slot];
+        resting[slot] = Resting();
+        return order;
+    }
+
+    void addResting(int64_t orderId, uint32_t symbolId) {
+        resting[restingNext++ & (resting.size() - 1)] = Resting{orderId, symbolId};
+    }
+
+    // Builds and sends the next request, due at `intended`
+    void send(uint64_t intended) {
+        char buffer[sizeof(WireNewOrder)] = {};
+        WireHeader header{};
+        header.magic = PROTOCOL_MAGIC;
+        header.version = PROTOCOL_VERSION;
+        header.symbolId = std::uniform_int_distribution<uint32_t>(0, config.symbols - 1)(rng);
+        header.sequence = ++sequence;
+
+        int kind = kinds(rng);
+        int64_t orderId = 0;
+        if (kind == Cancel || kind == Replace) {
+            Resting target = takeResting();
+            orderId = target.orderId;
+            if (orderId == 0) {
+                kind = Add;  // Nothing to cancel yet; keeps the random symbol
+            } else {
+                header.symbolId = target.symbolId;
+            }
+        }
+        size_t length;
+        if (kind == Cancel) {
+            header.type = static_cast<uint8_t>(WireType::Cancel);
+            WireCancel cancel{header, orderId};
+            std::memcpy(buffer, &cancel, sizeof(cancel));
+            length = sizeof(cancel);
+        } else if (kind == Replace) {
+            header.type = static_cast<uint8_t>(WireType::Replace);
+            WireReplace replace{header, orderId, price(),
+                                std::uniform_int_distribution<int>(1, config.maxQuantity)(rng)};
+            std::memcpy(buffer, &replace, sizeof(replace));
+            length = sizeof(replace);
+            addResting(orderId, header.symbolId);
+        } else {
+            header.type = static_cast<uint8_t>(WireType::NewOrder);
+            orderId = ++nextOrderId;
+            WireNewOrder order{};
+            order.header = header;
+            order.orderId = orderId;
+            order.price = price();
+            order.timestamp = static_cast<int64_t>(intended);
+            order.quantity = std::uniform_int_distribution<int>(1, config.maxQuantity)(rng);
+            order.traderId = config.traderId;
+            order.side = (rng() & 1) ? 'B' : 'S';
+            order.isMarketOrder = kind == Market;
+            order.timeInForce = static_cast<uint8_t>(kind == Ioc ? TimeInForce::IOC : TimeInForce::Day);
+            std::memcpy(buffer, &order, sizeof(order));
+            length = sizeof(order);
+            if (kind == Add) {
+                addResting(orderId, header.symbolId);
+            }
+        }
+
+        Pending& slot = pending[header.sequence & mask];
+        if (slot.sequence != 0) {
+            relaxedAdd(stats.lost, 1);  // Still unanswered a whole window later
+            --outstanding;
+        }
+        uint64_t sent = nowNs();
+        if (::send(fd, buffer, length, 0) < 0) {
+            relaxedAdd(stats.sendErrors, 1);
+            slot.sequence = 0;
+            return;
+        }
+        slot = Pending{header.sequence, intended, sent, orderId};
+        ++outstanding;
+        relaxedAdd(stats.sent, 1);
+        relaxedAdd(stats.byKind[kind], 1);
+    }
+
+    // Matches every reply waiting on the socket. Returns how many were read.
+    size_t receive() {
+        char buffer[2048];
+        size_t received = 0;
+        for (;;) {
+            ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (length < 0) {
+                return received;
+            }
+            uint64_t now = nowNs();
+            ++received;
+            if (static_cast<size_t>(length) < sizeof(WireAck)) {
+                relaxedAdd(stats.unmatched, 1);
+                continue;
+            }
+            WireAck ack;
+            std::memcpy(&ack, buffer, sizeof(ack));
+            Pending& slot = pending[ack.header.sequence & mask];
+            if (ack.header.magic != PROTOCOL_MAGIC || slot.sequence != ack.header.sequence ||
+                slot.orderId != ack.orderId) {
+                relaxedAdd(stats.unmatched, 1);
+                continue;
+            }
+            response.record(now - slot.intended);
+            service.record(now - slot.sent);
+            relaxedAdd(stats.acked, 1);
+            if (!ack.accepted) {
+                relaxedAdd(stats.rejected, 1);
+            }
+            slot.sequence = 0;
+            --outstanding;
+        }
+    }
+
+    // Sends on schedule from `start` until `end`, reading replies in between, then
+    // waits up to the timeout for the rest
+    void run(uint64_t start, uint64_t end) {
+        if (index < config.cores.size()) {
+            placeCurrentThread(config.cores[index], 0);
+        }
+        const double interval = 1e9 * config.threads / config.rate;
+        uint64_t due = 0;  // Requests scheduled so far
+        for (;;) {
+            uint64_t now = nowNs();
+            if (now >= end) {
+                break;
+            }
+            // Open loop: every request whose time has come goes out now, however
+            // late, and is timed from when it was due
+            uint64_t intended;
+            while ((intended = start + static_cast<uint64_t>(due * interval)) <= now && intended < end) {
+                send(intended);
+                ++due;
+            }
+            if (receive() == 0) {
+                cpuRelax();
+            }
+        }
+
+        uint64_t deadline = nowNs() + config.timeoutMs * 1000000;
+        while (outstanding > 0 && nowNs() < deadline) {
+            if (receive() == 0) {
+                cpuRelax();
+            }
+        }
+        relaxedAdd(stats.lost, outstanding);
+    }
+};
+
+std::vector<int> parseCores(const std::string& list) {
+    std::vector<int> cores;
+    std::istringstream ss(list);
+    std::string core;
+    while (std::getline(ss, core, ',')) {
+        cores.push_back(std::stoi(core));
+    }
+    return cores;
+}
+
+// "add=70,cancel=20,market=10"; kinds not named get weight 0
+void parseMix(const std::string& list, double (&mix)[KINDS]) {
+    std::fill(mix, mix + KINDS, 0.0);
+    std::istringstream ss(list);
+    std::string entry;
+    double total = 0;
+    while (std::getline(ss, entry, ',')) {
+        size_t equals = entry.find('=');
+        std::string name = entry.substr(0, equals);
+        int kind = 0;
+        while (kind < KINDS && name != KIND_NAMES[kind]) {
+            ++kind;
+        }
+        if (kind == KINDS || equals == std::string::npos) {
+            throw std::invalid_argument("Bad --mix entry " + entry);
+        }
+        mix[kind] = std::stod(entry.substr(equals + 1));
+        total += mix[kind];
+    }
+    if (!(total > 0)) {
+        throw std::invalid_argument("--mix needs a positive weight");
+    }
+}
+
+Config parseOptions(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--host") {
+            config.host = value();
+        } else if (arg == "--port") {
+            config.port = std::stoi(value());
+        } else if (arg == "--rate") {
+            config.rate = std::stod(value());
+        } else if (arg == "--threads") {
+            config.threads = std::stoul(value());
+        } else if (arg == "--duration") {
+            config.duration = std::stod(value());
+        } else if (arg == "--mix") {
+            parseMix(value(), config.mix);
+        } else if (arg == "--symbols") {
+            config.symbols = static_cast<uint32_t>(std::stoul(value()));
+        } else if (arg == "--price-mid") {
+            config.priceMid = std::stoll(value());
+        } else if (arg == "--price-width") {
+            config.priceWidth = std::stoll(value());
+        } else if (arg == "--price-dist") {
+            std::string dist = value();
+            if (dist != "uniform" && dist != "normal") {
+                throw std::invalid_argument("--price-dist is uniform or normal");
+            }
+            config.normalPrices = dist == "normal";
+        } else if (arg == "--max-qty") {
+            config.maxQuantity = std::stoi(value());
+        } else if (arg == "--trader") {
+            config.traderId = std::stoi(value());
+        } else if (arg == "--cores") {
+            config.cores = parseCores(value());
+        } else if (arg == "--timeout-ms") {
+            config.timeoutMs = std::stoull(value());
+        } else if (arg == "--window") {
+            config.window = std::stoul(value());
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    if (!(config.rate > 0) || config.threads == 0 || !(config.duration > 0) || config.symbols == 0 ||
+        config.maxQuantity <= 0 || config.priceWidth < 0 || config.window == 0) {
+        throw std::invalid_argument("--rate, --threads, --duration, --symbols, --max-qty and --window must be "
+                                    "positive and --price-width not negative");
+    }
+    return config;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Config config = parseOptions(argc, argv);
+
+        sockaddr_in server{};
+        server.sin_family = AF_INET;
+        server.sin_port = htons(static_cast<uint16_t>(config.port));
+        if (inet_pton(AF_INET, config.host.c_str(), &server.sin_addr) != 1) {
+            throw std::invalid_argument("Bad --host " + config.host);
+        }
+
+        // Order IDs: run tag in bits 48-62, thread in 40-47, counter below, so runs
+        // against a live book do not collide with orders still resting from the last
+        const int64_t idBase = static_cast<int64_t>(std::time(nullptr) & 0x7FFF) << 48;
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (size_t i = 0; i < config.threads; ++i) {
+            workers.push_back(std::make_unique<Worker>(config, i, server, idBase));
+        }
+
+        std::printf("loadgen: %s:%d rate=%.0f/s threads=%zu duration=%.1fs symbols=%u\n", config.host.c_str(),
+                    config.port, config.rate, config.threads, config.duration, config.symbols);
+        const uint64_t start = nowNs() + 10000000;  // Every thread starts on the same schedule
+        const uint64_t end = start + static_cast<uint64_t>(config.duration * 1e9);
+        std::atomic<size_t> running{workers.size()};
+        std::vector<std::thread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker, &running, start, end]() {
+                worker->run(start, end);
+                running.fetch_sub(1);
+            });
+        }
+
+        // Progress once a second: requests sent and answered in that second
+        uint64_t lastSent = 0, lastAcked = 0;
+        for (int second = 1; running.load() > 0; ++second) {
+            for (int tick = 0; tick < 100 && running.load() > 0; ++tick) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            uint64_t sent = 0, acked = 0, lost = 0;
+            for (auto& worker : workers) {
+                sent += worker->stats.sent.load(std::memory_order_relaxed);
+                acked += worker->stats.acked.load(std::memory_order_relaxed);
+                lost += worker->stats.lost.load(std::memory_order_relaxed);
+            }
+            std::printf("  %3ds sent=%llu/s acked=%llu/s in flight=%llu lost=%llu\n", second,
+                        static_cast<unsigned long long>(sent - lastSent),
+                        static_cast<unsigned long long>(acked - lastAcked),
+                        static_cast<unsigned long long>(sent - acked - lost), static_cast<unsigned long long>(lost));
+            lastSent = sent;
+            lastAcked = acked;
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        LatencyHistogram response, service;
+        uint64_t totals[6] = {};
+        uint64_t byKind[KINDS] = {};
+        for (auto& worker : workers) {
+            response.merge(worker->response);
+            service.merge(worker->service);
+            const WorkerStats& s = worker->stats;
+            const std::atomic<uint64_t>* counters[6] = {&s.sent, &s.acked, &s.rejected, &s.lost, &s.unmatched,
+                                                        &s.sendErrors};
+            for (int i = 0; i < 6; ++i) {
+                totals[i] += counters[i]->load(std::memory_order_relaxed);
+            }
+            for (int kind = 0; kind < KINDS; ++kind) {
+                byKind[kind] += s.byKind[kind].load(std::memory_order_relaxed);
+            }
+        }
+
+        std::printf("sent=%llu (%.0f/s) acked=%llu rejected=%llu lost=%llu unmatched=%llu sendErrors=%llu\n",
+                    static_cast<unsigned long long>(totals[0]), totals[0] / config.duration,
+                    static_cast<unsigned long long>(totals[1]), static_cast<unsigned long long>(totals[2]),
+                    static_cast<unsigned long long>(totals[3]), static_cast<unsigned long long>(totals[4]),
+                    static_cast<unsigned long long>(totals[5]));
+        std::printf("mix:");
+        for (int kind = 0; kind < KINDS; ++kind) {
+            std::printf(" %s=%llu", KIND_NAMES[kind], static_cast<unsigned long long>(byKind[kind]));
+        }
+        std::printf("\n%s  (from the scheduled send time)\n%s  (from the actual send time)\n",
+                    response.summary("response").c_str(), service.summary("service").c_str());
+        return totals[1] > 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+}
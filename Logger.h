@@ -5,14 +5,72 @@
 #include <fstream>
 #include <mutex>
 #include <string>
-#include <iomanip> // For formatting numbers
+#include <sstream>
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "SpscRing.h"
+#include "CpuAffinity.h"
 
+// Severity threshold; messages below the current level are skipped
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+// Hot-path events, logged as fixed-size binary records and formatted later
+enum class LogEvent : uint8_t {
+    OrderParsed,    // orderId, side, price, quantity, otherId = trader, value = client timestamp, flag = market
+    OrderAdded,     // orderId, side, price, quantity
+    Matching,       // orderId, side, otherId = resting order
+    NoMatch,        // orderId
+    Fill,           // orderId, otherId = resting order, quantity = filled
+    OrderCancelled, // orderId
+    OrderAmended,   // orderId, quantity
+    OrderReplaced,  // orderId, price, quantity
+    OrderResult     // orderId, side, symbolId, price, quantity, otherId = last match (0 if none),
+                    // value = latency ns, flag = matched
+};
+
+struct LogRecord {
+    uint64_t time;      // Capture time, nanoseconds since the logger started
+    LogEvent event;
+    char side;
+    bool flag;
+    int64_t orderId;
+    int64_t otherId;
+    int quantity;
+    uint32_t symbolId;
+    int64_t price;      // Ticks
+    int64_t value;
+};
+
+// Writes to stdout and output.txt. By default every call formats and writes
+// synchronously. After startAsync() the hot-path calls (logEvent, logOrder) only
+// push a LogRecord into a per-thread lock-free ring, and a background thread
+// formats and writes them. Free-form log() messages are rare and always written
+// directly, so in async mode they may appear ahead of queued records.
 class Logger {
 private:
+    static constexpr size_t MAX_THREADS = 64;
+    static constexpr size_t RING_CAPACITY = 1 << 16;
+
+    using Ring = SpscRing<LogRecord>;
+
     std::ofstream file;
-    std::mutex log_mutex;
+    std::mutex log_mutex;     // Serialises writes to the outputs
+    std::mutex ring_mutex;    // Serialises ring registration
+    std::atomic<LogLevel> level{LogLevel::Info};
+    std::chrono::steady_clock::time_point startTime;
+
+    std::array<std::unique_ptr<Ring>, MAX_THREADS> rings;  // One per producing thread
+    std::atomic<size_t> ringCount{0};
+    std::atomic<bool> asyncMode{false};
+    std::atomic<bool> writerRunning{false};
+    std::atomic<uint64_t> dropped{0};  // Records lost to full rings
+    std::thread writer;
 
-    Logger() {
+    Logger() : startTime(std::chrono::steady_clock::now()) {
         file.open("output.txt", std::ios::out | std::ios::trunc);
         if (!file.is_open()) {
             throw std::ios_base::failure("Failed to open log file.");
@@ -20,11 +78,131 @@ private:
     }
 
     ~Logger() {
+        stopAsync();
         if (file.is_open()) {
             file.close();
         }
     }
 
+    // The calling thread's ring, registered on first use. Null once MAX_THREADS
+    // rings exist; such threads fall back to synchronous writes.
+    Ring* localRing() {
+        static thread_local Ring* ring = nullptr;
+        static thread_local bool registered = false;
+        if (!registered) {
+            std::lock_guard<std::mutex> lock(ring_mutex);
+            size_t index = ringCount.load(std::memory_order_relaxed);
+            if (index < MAX_THREADS) {
+                rings[index] = std::make_unique<Ring>(RING_CAPACITY);
+                ring = rings[index].get();
+                ringCount.store(index + 1, std::memory_order_release);
+            }
+            registered = true;
+        }
+        return ring;
+    }
+
+    void write(const std::string& text) {
+        std::cout << text << '\n';
+        if (file.is_open()) {
+            file << text << '\n';
+        }
+    }
+
+    void flushOutputs() {
+        std::cout.flush();
+        if (file.is_open()) {
+            file.flush();
+        }
+    }
+
+    static const char* sideName(char side) {
+        return side == 'B' ? "Buy" : "Sell";
+    }
+
+    std::string format(const LogRecord& r) const {
+        std::ostringstream oss;
+        oss << '[' << r.time / 1000 << " us] ";
+
+        switch (r.event) {
+            case LogEvent::OrderParsed:
+                oss << "Order parsed successfully: ID=" << r.orderId << ", Side=" << r.side
+                    << ", Price=" << r.price << " ticks, Quantity=" << r.quantity
+                    << ", Timestamp=" << r.value << ", TraderID=" << r.otherId
+                    << ", MarketOrder=" << r.flag;
+                break;
+            case LogEvent::OrderAdded:
+                oss << "Order added to book: ID = " << r.orderId << ", Side = " << sideName(r.side)
+                    << ", Price = " << r.price << " ticks, Quantity = " << r.quantity;
+                break;
+            case LogEvent::Matching:
+                oss << "Matching " << sideName(r.side) << " Order ID: " << r.orderId << " with "
+                    << sideName(r.side == 'B' ? 'S' : 'B') << " Order ID: " << r.otherId;
+                break;
+            case LogEvent::NoMatch:
+                oss << "No match found for Order ID: " << r.orderId;
+                break;
+            case LogEvent::Fill:
+                oss << "Matched Order: " << r.orderId << " with Order ID " << r.otherId
+                    << " for quantity: " << r.quantity;
+                break;
+            case LogEvent::OrderCancelled:
+                oss << "Order cancelled: ID = " << r.orderId;
+                break;
+            case LogEvent::OrderAmended:
+                oss << "Order amended: ID = " << r.orderId << ", Quantity = " << r.quantity;
+                break;
+            case LogEvent::OrderReplaced:
+                oss << "Order replaced: ID = " << r.orderId << ", Price = " << r.price
+                    << " ticks, Quantity = " << r.quantity;
+                break;
+            case LogEvent::OrderResult:
+                oss << "\n=========================================\n"
+                    << "Order ID:      " << r.orderId << "\n"
+                    << "Type:          " << r.side << "\n"
+                    << "Symbol ID:     " << r.symbolId << "\n"
+                    << "Price:         " << r.price << " ticks\n"
+                    << "Quantity:      " << r.quantity << "\n"
+                    << "Action:        " << (r.flag ? "Matched" : "Added to Book") << "\n"
+                    << "Matched With:  ";
+                if (r.otherId)
+                    oss << "Order ID " << r.otherId << "\n";
+                else
+                    oss << "None\n";
+                oss << "Latency:       " << r.value << " ns\n"
+                    << "-----------------------------------------";
+                break;
+        }
+        return oss.str();
+    }
+
+    // Pops and writes everything queued so far. Returns the number of records written.
+    size_t drain() {
+        size_t written = 0;
+        size_t count = ringCount.load(std::memory_order_acquire);
+        LogRecord record;
+        std::lock_guard<std::mutex> lock(log_mutex);
+        for (size_t i = 0; i < count; ++i) {
+            while (rings[i]->tryPop(record)) {
+                write(format(record));
+                ++written;
+            }
+        }
+        if (written) {
+            flushOutputs();
+        }
+        return written;
+    }
+
+    void writerLoop() {
+        while (writerRunning.load(std::memory_order_acquire)) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        drain();
+    }
+
 public:
     static Logger& getInstance() {
         static Logger instance;
@@ -34,35 +212,105 @@ public:
     Logger(const Logger&) = delete;
     void operator=(const Logger&) = delete;
 
-    void log(const std::string& message) {
-        std::lock_guard<std::mutex> lock(log_mutex);
-        std::cout << message << std::endl;
-        if (file.is_open()) {
-            file << message << std::endl;
+    void setLevel(LogLevel newLevel) { level.store(newLevel, std::memory_order_relaxed); }
+    LogLevel getLevel() const { return level.load(std::memory_order_relaxed); }
+
+    bool isEnabled(LogLevel messageLevel) const {
+        return messageLevel >= level.load(std::memory_order_relaxed);
+    }
+
+    // Parses "debug", "info", "warn", "error" or "off"
+    static LogLevel parseLevel(const std::string& name) {
+        if (name == "debug") return LogLevel::Debug;
+        if (name == "info") return LogLevel::Info;
+        if (name == "warn") return LogLevel::Warn;
+        if (name == "error") return LogLevel::Error;
+        if (name == "off") return LogLevel::Off;
+        throw std::invalid_argument("Unknown log level: " + name);
+    }
+
+    // Starts the background writer, pinned to `core` unless it is -1; from now on
+    // events are queued instead of written
+    void startAsync(int core = -1) {
+        if (writerRunning.exchange(true)) {
+            return;
         }
+        writer = std::thread([this, core]() {
+            if (core >= 0) {
+                log("Log writer " + placeCurrentThread(core, 0));
+            }
+            writerLoop();
+        });
+        asyncMode.store(true, std::memory_order_release);
     }
 
-    void logOrder(int id, const char side, double price, int quantity,
-                  const std::string& action, const std::string& matchedWith,
-                  int latency) {
+    // Writes out everything queued and returns to synchronous logging. Call once
+    // the producing threads have stopped; later pushes would not be written.
+    void stopAsync() {
+        asyncMode.store(false, std::memory_order_release);
+        if (writerRunning.exchange(false) && writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    // In async mode, registers the calling thread's ring now, so its first
+    // queued event does not allocate
+    void prepareThread() {
+        if (asyncMode.load(std::memory_order_acquire)) {
+            localRing();
+        }
+    }
+
+    uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+
+    void log(const std::string& message, LogLevel messageLevel = LogLevel::Info) {
+        if (!isEnabled(messageLevel)) {
+            return;
+        }
         std::lock_guard<std::mutex> lock(log_mutex);
-        std::ostringstream oss;
+        write(message);
+        flushOutputs();
+    }
 
-        oss << "=========================================\n"
-            << "Order ID:      " << id << "\n"
-            << "Type:          " << side << "\n"
-            << "Price:         " << std::fixed << std::setprecision(2) << price << "\n"
-            << "Quantity:      " << quantity << "\n"
-            << "Action:        " << action << "\n"
-            << "Matched With:  " << matchedWith << "\n"
-            << "Latency:       " << latency << " microseconds\n"
-            << "-----------------------------------------";
-
-        std::string formattedLog = oss.str();
-        std::cout << formattedLog << std::endl;
-        if (file.is_open()) {
-            file << formattedLog << std::endl;
+    // Records a hot-path event. Disabled levels return before building the record.
+    void logEvent(LogLevel messageLevel, LogEvent event, int64_t orderId, char side = 'N',
+                  int64_t price = 0, int quantity = 0, int64_t otherId = 0,
+                  int64_t value = 0, bool flag = false, uint32_t symbolId = 0) {
+        if (!isEnabled(messageLevel)) {
+            return;
         }
+
+        LogRecord record;
+        record.time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - startTime).count());
+        record.event = event;
+        record.side = side;
+        record.flag = flag;
+        record.orderId = orderId;
+        record.otherId = otherId;
+        record.quantity = quantity;
+        record.symbolId = symbolId;
+        record.price = price;
+        record.value = value;
+
+        if (asyncMode.load(std::memory_order_acquire)) {
+            if (Ring* ring = localRing()) {
+                if (!ring->tryPush(record)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(log_mutex);
+        write(format(record));
+        flushOutputs();
+    }
+
+    void logOrder(int64_t id, const char side, uint32_t symbolId, int64_t price, int quantity,
+                  bool matched, int64_t matchedWith, int64_t latency) {
+        logEvent(LogLevel::Info, LogEvent::OrderResult, id, side, price, quantity,
+                 matchedWith, latency, matched, symbolId);
     }
 };
 
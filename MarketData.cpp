@@ -0,0 +1,116 @@
+#include "MarketData.h"
+#include "Logger.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MarketDataPublisher::MarketDataPublisher(const std::vector<std::unique_ptr<OrderBook>>& books,
+                                         const MarketDataConfig& config, uint16_t streamId)
+    : books(books), config(config), streamId(streamId) {
+    incrementalAddr = sockaddr_in{};
+    incrementalAddr.sin_family = AF_INET;
+    incrementalAddr.sin_port = htons(config.port);
+    if (inet_pton(AF_INET, config.address.c_str(), &incrementalAddr.sin_addr) != 1) {
+        throw std::runtime_error("Invalid market data address: " + config.address);
+    }
+    refreshAddr = incrementalAddr;
+    refreshAddr.sin_port = htons(static_cast<uint16_t>(config.port + 1));
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_fd < 0) {
+        throw std::runtime_error("Failed to create market data socket.");
+    }
+
+    // Keep multicast on the local network and let local subscribers see it
+    if (IN_MULTICAST(ntohl(incrementalAddr.sin_addr.s_addr))) {
+        unsigned char ttl = 1;
+        unsigned char loop = 1;
+        setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+
+    touched.reserve(1024);
+    trades.reserve(1024);
+    pending.reserve(2048);
+}
+
+MarketDataPublisher::~MarketDataPublisher() {
+    close(socket_fd);
+}
+
+void MarketDataPublisher::send(MdType type, const std::vector<MdEntry>& entries, const sockaddr_in& to) {
+    MdHeader header{};
+    header.magic = MD_MAGIC;
+    header.version = MD_VERSION;
+    header.type = static_cast<uint8_t>(type);
+    header.streamId = streamId;
+
+    size_t sent = 0;
+    do {
+        size_t count = std::min(entries.size() - sent, ENTRIES_PER_PACKET);
+        header.count = static_cast<uint16_t>(count);
+        header.sequence = type == MdType::Incremental ? ++sequence : sequence;
+        header.flags = sent + count == entries.size() ? MD_LAST_PACKET : 0;
+
+        std::memcpy(packet, &header, sizeof(header));
+        std::memcpy(packet + sizeof(header), entries.data() + sent, count * sizeof(MdEntry));
+        size_t length = sizeof(header) + count * sizeof(MdEntry);
+        if (sendto(socket_fd, packet, length, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) < 0) {
+            Logger::getInstance().log("Error: Failed to send market data.", LogLevel::Error);
+        }
+        sent += count;
+    } while (sent < entries.size());
+}
+
+void MarketDataPublisher::flush() {
+    if (!touched.empty() || !trades.empty()) {
+        // Each level once, with the quantity it has now
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+        pending.assign(trades.begin(), trades.end());
+        for (const LevelKey& level : touched) {
+            int64_t quantity = books[level.symbolId]->levelQuantity(level.side, level.price);
+            pending.push_back(MdEntry{static_cast<uint8_t>(MdEntryKind::Level), level.side, 0, level.symbolId,
+                                      level.price, quantity});
+        }
+        send(MdType::Incremental, pending, incrementalAddr);
+        touched.clear();
+        trades.clear();
+    }
+
+    uint64_t now = nowNs();
+    if (lastRefreshNs == 0 || now - lastRefreshNs >= uint64_t{config.refreshMs} * 1000000) {
+        lastRefreshNs = now;
+        refresh();
+    }
+}
+
+// Sent from the engine's thread between requests, so it is consistent with the
+// incrementals numbered up to `sequence`
+void MarketDataPublisher::refresh() {
+    pending.clear();
+    for (uint32_t symbolId = 0; symbolId < books.size(); ++symbolId) {
+        books[symbolId]->forEachLevel([&](char side, int64_t price, int64_t quantity) {
+            pending.push_back(MdEntry{static_cast<uint8_t>(MdEntryKind::Level), side, 0, symbolId, price, quantity});
+        });
+    }
+    send(MdType::Refresh, pending, refreshAddr);
+}
+
+void parseMarketDataAddress(const std::string& text, MarketDataConfig& config) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == text.size()) {
+        throw std::invalid_argument("Market data address must be <host>:<port>: " + text);
+    }
+    config.address = text.substr(0, colon);
+    unsigned long port = std::stoul(text.substr(colon + 1));
+    if (port == 0 || port >= 65535) {
+        throw std::invalid_argument("Invalid market data port: " + text);
+    }
+    config.port = static_cast<uint16_t>(port);
+}
@@ -0,0 +1,145 @@
+#ifndef MARKET_DATA_H
+#define MARKET_DATA_H
+
+#include "OrderBook.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+
+// Level 2 market-data feed. Every datagram is an MdHeader followed by
+// MdHeader::count MdEntry records, packed and little-endian like Protocol.h.
+//
+// Incremental packets go to the configured address and port. Each carries the
+// next sequence number of its stream (one stream per matching engine or shard),
+// trades in execution order, then the new aggregate quantity of every level that
+// changed; quantity 0 means the level is gone. Refresh packets go to port + 1
+// and list every level of every book. A refresh reflects all incremental packets
+// up to its `sequence`, so a late joiner applies the incrementals after it.
+
+#pragma pack(push, 1)
+
+struct MdHeader {
+    uint16_t magic;       // MD_MAGIC
+    uint8_t version;      // MD_VERSION
+    uint8_t type;         // MdType
+    uint16_t streamId;
+    uint16_t count;       // MdEntry records that follow
+    uint64_t sequence;    // Incremental: this packet. Refresh: last incremental it reflects.
+    uint8_t flags;        // MD_LAST_PACKET
+    uint8_t reserved[7];
+};
+
+struct MdEntry {
+    uint8_t kind;         // MdEntryKind
+    char side;            // Level side, or the aggressor's side for a trade
+    uint16_t reserved;
+    uint32_t symbolId;
+    int64_t price;        // Ticks
+    int64_t quantity;     // Level: aggregate open quantity. Trade: traded quantity.
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MdHeader) == 24, "MdHeader layout changed");
+static_assert(sizeof(MdEntry) == 24, "MdEntry layout changed");
+
+constexpr uint16_t MD_MAGIC = 0x4DA5;      // Bytes A5 4D on the wire
+constexpr uint8_t MD_VERSION = 1;
+constexpr uint8_t MD_LAST_PACKET = 1;      // Final packet of an incremental update or a refresh
+
+enum class MdType : uint8_t {
+    Incremental = 1,
+    Refresh = 2
+};
+
+enum class MdEntryKind : uint8_t {
+    Level = 1,
+    Trade = 2
+};
+
+// When incremental updates are sent
+enum class Conflation {
+    Message,  // After every request: a sweep through many levels is one update
+    Batch     // At OrderHandler::commit(), i.e. once per received batch or drained queue
+};
+
+struct MarketDataConfig {
+    std::string address = "127.0.0.1";   // Multicast group or unicast host
+    uint16_t port = 5000;                // Incrementals; refreshes use port + 1
+    Conflation conflation = Conflation::Message;
+    uint32_t refreshMs = 1000;           // Minimum time between refreshes
+};
+
+// Collects the levels and trades touched by one engine and publishes them. Level
+// quantities are read from the books when the update is sent, so a level touched
+// many times is sent once with its final quantity. Used by the engine's thread only.
+class MarketDataPublisher {
+private:
+    struct LevelKey {
+        uint32_t symbolId;
+        char side;
+        int64_t price;
+
+        bool operator<(const LevelKey& other) const {
+            if (symbolId != other.symbolId) return symbolId < other.symbolId;
+            if (side != other.side) return side < other.side;
+            return price < other.price;
+        }
+        bool operator==(const LevelKey& other) const {
+            return symbolId == other.symbolId && side == other.side && price == other.price;
+        }
+    };
+
+    static constexpr size_t MAX_PACKET = 1472;
+    static constexpr size_t ENTRIES_PER_PACKET = (MAX_PACKET - sizeof(MdHeader)) / sizeof(MdEntry);
+
+    const std::vector<std::unique_ptr<OrderBook>>& books;
+    MarketDataConfig config;
+    uint16_t streamId;
+    int socket_fd;
+    sockaddr_in incrementalAddr;
+    sockaddr_in refreshAddr;
+    uint64_t sequence = 0;        // Last incremental packet sent
+    uint64_t lastRefreshNs = 0;   // 0: no refresh sent yet
+
+    std::vector<LevelKey> touched;
+    std::vector<MdEntry> trades;
+    std::vector<MdEntry> pending;  // Entries of the update being sent
+    char packet[MAX_PACKET];
+
+    // Sends `entries` as as many packets as needed, each with its own sequence for incrementals
+    void send(MdType type, const std::vector<MdEntry>& entries, const sockaddr_in& to);
+    void refresh();
+
+public:
+    // Publishes the books of one engine. Throws std::runtime_error if the socket cannot be set up.
+    MarketDataPublisher(const std::vector<std::unique_ptr<OrderBook>>& books, const MarketDataConfig& config,
+                        uint16_t streamId);
+    ~MarketDataPublisher();
+
+    MarketDataPublisher(const MarketDataPublisher&) = delete;
+    MarketDataPublisher& operator=(const MarketDataPublisher&) = delete;
+
+    void levelChanged(uint32_t symbolId, char side, int64_t price) { touched.push_back({symbolId, side, price}); }
+
+    void trade(uint32_t symbolId, char aggressorSide, int64_t price, int quantity) {
+        trades.push_back(MdEntry{static_cast<uint8_t>(MdEntryKind::Trade), aggressorSide, 0, symbolId, price, quantity});
+    }
+
+    // End of one request; sends the update unless conflating by batch
+    void endMessage() {
+        if (config.conflation == Conflation::Message) {
+            flush();
+        }
+    }
+
+    // Sends everything collected as one update, then a refresh if one is due
+    void flush();
+};
+
+// Parses "<host>:<port>"
+void parseMarketDataAddress(const std::string& text, MarketDataConfig& config);
+
+#endif // MARKET_DATA_H
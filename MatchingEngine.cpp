@@ -1,45 +1,382 @@
 #include "MatchingEngine.h"
 #include "Logger.h"
+#include "Snapshot.h"
 #include <ctime>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+MatchingEngine::MatchingEngine(const BookCapacity& capacity, size_t symbolCount,
+                               const std::vector<LadderConfig>& ladders)
+    : memory(capacity) {
+    books.reserve(symbolCount);
+    size_t laddered = 0;
+    for (size_t symbolId = 0; symbolId < symbolCount; ++symbolId) {
+        LadderConfig ladder = symbolId < ladders.size() ? ladders[symbolId] : LadderConfig();
+        books.push_back(std::make_unique<OrderBook>(memory, static_cast<uint32_t>(symbolId), ladder));
+        laddered += ladder.width > 0;
+    }
+
+    Logger::getInstance().log("Order book memory: " + std::to_string(capacity.maxOrders) + " orders, " +
+                              std::to_string(capacity.maxLevels) + " price levels, huge pages " +
+                              (memory.orders.usingHugePages() ? "on" : "off") + ", " +
+                              std::to_string(symbolCount) + " symbols, " + std::to_string(laddered) +
+                              " with price ladders");
+}
+
+MatchingEngine::~MatchingEngine() {
+    reapSnapshot(true);
+}
+
+OrderBook& MatchingEngine::bookFor(uint32_t symbolId) {
+    if (symbolId >= books.size()) {
+        throw std::invalid_argument("Unknown symbol ID " + std::to_string(symbolId));
+    }
+    return *books[symbolId];
+}
+
+void MatchingEngine::processMessage(const OrderMessage& message, ExecutionReport& report) {
+    report.clear();
+    report.orderId = message.order.orderId;
+
+    try {
+        switch (message.type) {
+            case MessageType::NewOrder:
+                processOrder(message.order, report);
+                break;
+            case MessageType::Cancel:
+                cancelOrder(message.order.symbolId, message.order.orderId, report);
+                break;
+            case MessageType::Replace:
+                replaceOrder(message.order.symbolId, message.order.orderId, message.order.price,
+                             message.order.quantity, report);
+                break;
+            case MessageType::Snapshot:
+                writeSnapshot(message.sequence);
+                break;
+        }
+    } catch (...) {
+        relaxedAdd(stats.rejects, 1);
+        throw;
+    }
+
+    stats.restingOrders.store(memory.orders.size(), std::memory_order_relaxed);
+    stats.bookLevels.store(memory.levels.size(), std::memory_order_relaxed);
+
+    if (marketData) {
+        marketData->endMessage();
+    }
+}
+
+void MatchingEngine::replayMessage(const OrderMessage& message, ExecutionReport& report) {
+    replaying = true;
+    OrderHandler::replayMessage(message, report);
+    replaying = false;
+}
+
+void MatchingEngine::commit() {
+    if (marketData) {
+        marketData->flush();
+    }
+}
+
+void MatchingEngine::enableMarketData(const MarketDataConfig& config, uint16_t streamId) {
+    marketData = std::make_unique<MarketDataPublisher>(books, config, streamId);
+}
+
+void MatchingEngine::enableRisk(const RiskLimits& limits, const std::vector<double>& tickSizes, bool checkRate) {
+    risk = std::make_unique<PreTradeRisk>(limits, books.size(), tickSizes, checkRate);
+}
+
+void MatchingEngine::enableSnapshots(const std::string& dir, uint32_t part, uint32_t parts) {
+    snapshotDir = dir;
+    snapshotPart = part;
+    snapshotParts = parts;
+}
+
+bool MatchingEngine::reapSnapshot(bool wait) {
+    if (snapshotChild < 0) {
+        return true;
+    }
+    int status = 0;
+    pid_t done = waitpid(snapshotChild, &status, wait ? 0 : WNOHANG);
+    if (done == 0) {
+        return false;
+    }
+    snapshotChild = -1;
 
-void MatchingEngine::processOrder(Order order) {
     Logger& logger = Logger::getInstance();
+    if (done > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        logger.log("Snapshot " + std::to_string(snapshotSequence) + " part " + std::to_string(snapshotPart) +
+                   " written");
+        pruneSnapshots(snapshotDir, snapshotPart, snapshotParts, 2);  // Keep one to fall back on
+    } else {
+        logger.log("Snapshot " + std::to_string(snapshotSequence) + " part " + std::to_string(snapshotPart) +
+                   " failed", LogLevel::Error);
+    }
+    return true;
+}
+
+void MatchingEngine::writeSnapshot(uint64_t sequence) {
+    if (snapshotDir.empty()) {
+        throw std::runtime_error("Snapshots are not enabled");
+    }
+    if (!reapSnapshot(false)) {
+        throw std::runtime_error("Snapshot " + std::to_string(snapshotSequence) + " is still being written");
+    }
+
+    // Everything the child needs is prepared here: after fork() only this thread
+    // exists in the child, so it must not allocate or take locks
+    const std::string finalPath = snapshotPath(snapshotDir, sequence, snapshotPart);
+    const std::string tempPath = snapshotDir + "/.snapshot.tmp." + std::to_string(snapshotPart);
+    SnapshotHeader header{};
+    header.part = snapshotPart;
+    header.parts = snapshotParts;
+    header.symbolCount = static_cast<uint32_t>(books.size());
+    header.sequence = sequence;
+
+    pid_t child = fork();
+    if (child < 0) {
+        throw std::runtime_error("Failed to fork snapshot writer");
+    }
+    if (child == 0) {
+        SnapshotWriter writer(tempPath.c_str());
+        for (const auto& book : books) {
+            book->forEachOrder([&writer](const Order& order) { writer.add(order); });
+        }
+        _exit(writer.finish(header, tempPath.c_str(), finalPath.c_str()) ? 0 : 1);
+    }
+
+    snapshotChild = child;
+    snapshotSequence = sequence;
+    Logger::getInstance().log("Snapshot " + std::to_string(sequence) + " part " + std::to_string(snapshotPart) +
+                              " started");
+}
+
+void MatchingEngine::loadSnapshot(uint64_t sequence) {
+    const std::string path = snapshotPath(snapshotDir, sequence, snapshotPart);
+    size_t loaded = 0;
+    SnapshotHeader header = readSnapshot(path, [&](const Order& order) {
+        if (!bookFor(order.symbolId).addOrder(order)) {
+            throw std::runtime_error("Snapshot " + path + " repeats order ID " + std::to_string(order.orderId));
+        }
+        if (risk) {
+            risk->rested(order.traderId, order.symbolId, order.side, order.quantity);
+        }
+        ++loaded;
+    });
+    if (header.sequence != sequence || header.part != snapshotPart || header.parts != snapshotParts ||
+        header.symbolCount != books.size()) {
+        throw std::runtime_error("Snapshot " + path + " was written by a different configuration");
+    }
+
+    stats.restingOrders.store(memory.orders.size(), std::memory_order_relaxed);
+    stats.bookLevels.store(memory.levels.size(), std::memory_order_relaxed);
+    Logger::getInstance().log("Loaded " + std::to_string(loaded) + " orders from " + path);
+}
+
+std::string MatchingEngine::statsReport() const {
+    uint64_t orders = stats.orders.load(std::memory_order_relaxed);
+    double seconds = (nowNs() - stats.startedAt) / 1e9;
+
+    std::ostringstream oss;
+    oss << stats.match.summary("match") << "\n"
+        << "engine: orders=" << orders
+        << " fills=" << stats.fills.load(std::memory_order_relaxed)
+        << " cancels=" << stats.cancels.load(std::memory_order_relaxed)
+        << " replaces=" << stats.replaces.load(std::memory_order_relaxed)
+        << " rejects=" << stats.rejects.load(std::memory_order_relaxed)
+        << " expired=" << stats.expired.load(std::memory_order_relaxed)
+        << " resting=" << stats.restingOrders.load(std::memory_order_relaxed)
+        << " levels=" << stats.bookLevels.load(std::memory_order_relaxed)
+        << " ordersPerSec=" << static_cast<uint64_t>(seconds > 0 ? orders / seconds : 0) << "\n";
+    if (risk) {
+        oss << risk->report();
+    }
+    return oss.str();
+}
+
+int64_t MatchingEngine::marketLimit(const OrderBook& book, char side) const {
+    bool isBuy = side == 'B';
+    const AVLTree::Node* best = isBuy ? book.bestAsk() : book.bestBid();
+    if (!best || priceBand == 0) {
+        return isBuy ? std::numeric_limits<int64_t>::max() : std::numeric_limits<int64_t>::min();
+    }
+    return isBuy ? best->price + priceBand : best->price - priceBand;
+}
+
+void MatchingEngine::checkRisk(const OrderBook& book, const Order& order, uint64_t now) {
+    if (!risk || replaying) {
+        return;
+    }
+    // A market order is valued at the touch it will trade against
+    int64_t reference = 0;
+    if (order.isMarketOrder) {
+        const AVLTree::Node* best = order.side == 'B' ? book.bestAsk() : book.bestBid();
+        reference = best ? best->price : 0;
+    }
+    risk->check(order, reference, now);
+}
 
+void MatchingEngine::processOrder(Order order, ExecutionReport& report) {
     if (order.orderId == 0)
         return;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    OrderBook& orderBook = bookFor(order.symbolId);
+    report.side = order.side;
+
+    // IDs are indexed across every book of this engine
+    if (memory.index.find(order.orderId)) {
+        throw std::invalid_argument("Duplicate order ID " + std::to_string(order.orderId));
+    }
+
+    uint64_t start = nowNs();
+    checkRisk(orderBook, order, start);
+    executeOrder(orderBook, order, report, start);
+}
+
+void MatchingEngine::executeOrder(OrderBook& orderBook, Order order, ExecutionReport& report, uint64_t start) {
+    Logger& logger = Logger::getInstance();
+
+    // A market order trades down to the protection limit and never rests
+    bool rests = order.timeInForce == TimeInForce::Day && !order.isMarketOrder;
+    if (order.isMarketOrder) {
+        order.price = marketLimit(orderBook, order.side);
+    }
 
-    bool matched = false;
-    std::string matchedWith = "None";
+    // Fill or kill: cached level totals tell whether it can fill before anything trades
+    const size_t firstFill = report.fills.size();
+    size_t fillCount = 0;
+    if (order.timeInForce != TimeInForce::FOK ||
+        orderBook.crossableQuantity(order.side, order.price, order.quantity) >= order.quantity) {
+        // Sweep every crossing level in one call
+        fillCount = orderBook.matchOrder(order, report.fills, risk != nullptr);
+    }
+
+    // What is left rests, or is cancelled if it may not. By now makers may be gone
+    // (and a replaced order cancelled), so running out of capacity cancels the
+    // rest rather than throwing: the fills stand and are reported below.
+    if (order.quantity > 0 && rests) {
+        try {
+            orderBook.addOrder(order);
+            report.openQuantity = order.quantity;
+        } catch (const std::runtime_error& e) {
+            logger.log("Order " + std::to_string(order.orderId) + " cannot rest, remainder cancelled: " + e.what(),
+                       LogLevel::Warn);
+            report.cancelledQuantity = order.quantity;
+        }
+    } else {
+        report.cancelledQuantity = order.quantity;
+    }
 
-    // Try to match the order
-    while (order.quantity > 0) {
-        auto [isMatched, matchedOrder] = orderBook.matchOrder(order);
-        if (!isMatched) {
-            break;
+    if (risk) {
+        for (size_t i = firstFill; i < report.fills.size(); ++i) {
+            risk->filled(order, report.fills[i]);
+        }
+        if (report.openQuantity > 0) {
+            risk->rested(order.traderId, order.symbolId, order.side, report.openQuantity);
         }
+    }
 
-        matched = true;
-        matchedWith = "Order ID " + std::to_string(matchedOrder.orderId);
-        logger.log("Matched Order: " + std::to_string(order.orderId) +
-                   " with " + matchedWith + " for quantity: " + std::to_string(matchedOrder.quantity));
+    // Timed before any logging so the histogram reflects matching alone
+    uint64_t latency = nowNs() - start;
+    stats.match.record(latency);
+    relaxedAdd(stats.orders, 1);
+    relaxedAdd(stats.fills, fillCount);
+    if (report.cancelledQuantity > 0) {
+        relaxedAdd(stats.expired, 1);
     }
 
-    // If the order is not fully matched, add it to the book
-    if (order.quantity > 0) {
-        orderBook.addOrder(order);
-        logger.log("Order added to book: ID = " + std::to_string(order.orderId) +
-                   ", Side = " + (order.side == 'B' ? 'B' : 'S') +
-                   ", Price = " + std::to_string(order.price) +
-                   ", Quantity = " + std::to_string(order.quantity));
+    if (marketData) {
+        char makerSide = order.side == 'B' ? 'S' : 'B';
+        for (size_t i = firstFill; i < report.fills.size(); ++i) {
+            const Fill& fill = report.fills[i];
+            marketData->trade(order.symbolId, order.side, fill.price, fill.quantity);
+            marketData->levelChanged(order.symbolId, makerSide, fill.price);
+        }
+        if (report.openQuantity > 0) {
+            marketData->levelChanged(order.symbolId, order.side, order.price);
+        }
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    bool matched = fillCount > 0;
+    OrderId matchedWith = matched ? report.fills.back().makerId : 0;    // Last resting order matched
+
+    for (size_t i = firstFill; i < report.fills.size(); ++i) {
+        const Fill& fill = report.fills[i];
+        logger.logEvent(LogLevel::Info, LogEvent::Fill, order.orderId, order.side, fill.price,
+                        fill.quantity, fill.makerId);
+    }
 
     // Log the result
-    logger.logOrder(order.orderId, (order.side == 'B' ? 'B' : 'S'), order.price, order.quantity,
-                    (matched ? "Matched" : "Added to Book"), matchedWith, latency);
+    logger.logOrder(order.orderId, (order.side == 'B' ? 'B' : 'S'), order.symbolId, order.price,
+                    order.quantity, matched, matchedWith, latency);
+}
+
+void MatchingEngine::cancelOrder(uint32_t symbolId, OrderId orderId, ExecutionReport& report) {
+    OrderBook& orderBook = bookFor(symbolId);
+    Order resting;
+    if (!orderBook.findOrder(orderId, resting)) {
+        throw std::invalid_argument("Unknown order ID " + std::to_string(orderId));
+    }
+    if (marketData) {
+        marketData->levelChanged(symbolId, resting.side, resting.price);
+    }
+    orderBook.cancelOrder(orderId);
+    if (risk) {
+        risk->removed(resting.traderId, symbolId, resting.side, resting.quantity);
+    }
+    report.openQuantity = 0;
+    relaxedAdd(stats.cancels, 1);
+    Logger::getInstance().logEvent(LogLevel::Info, LogEvent::OrderCancelled, orderId);
 }
 
+// A quantity-down amend at the same price keeps queue priority. Any other change
+// cancels the resting order and re-enters it as a new order, which may match.
+void MatchingEngine::replaceOrder(uint32_t symbolId, OrderId orderId, int64_t price, int quantity,
+                                  ExecutionReport& report) {
+    OrderBook& orderBook = bookFor(symbolId);
+    Order resting;
+    if (!orderBook.findOrder(orderId, resting)) {
+        throw std::invalid_argument("Unknown order ID " + std::to_string(orderId));
+    }
+    relaxedAdd(stats.replaces, 1);
+    if (marketData) {
+        marketData->levelChanged(symbolId, resting.side, resting.price);
+    }
+
+    if (price == resting.price && orderBook.reduceOrder(orderId, quantity)) {
+        if (risk) {
+            risk->removed(resting.traderId, symbolId, resting.side, resting.quantity - quantity);
+        }
+        report.openQuantity = quantity;
+        Logger::getInstance().logEvent(LogLevel::Info, LogEvent::OrderAmended, orderId, resting.side,
+                                       price, quantity);
+        return;
+    }
+
+    Order replacement = resting;
+    replacement.price = price;
+    replacement.quantity = quantity;
+
+    // Checked as a new order, without the quantity it replaces counting as working.
+    // A replacement that fails leaves the resting order as it was.
+    uint64_t start = nowNs();
+    if (risk) {
+        risk->removed(resting.traderId, symbolId, resting.side, resting.quantity);
+        try {
+            checkRisk(orderBook, replacement, start);
+        } catch (...) {
+            risk->rested(resting.traderId, symbolId, resting.side, resting.quantity);
+            throw;
+        }
+    }
+
+    orderBook.cancelOrder(orderId);
+    Logger::getInstance().logEvent(LogLevel::Info, LogEvent::OrderReplaced, orderId, replacement.side,
+                                   price, quantity);
+    report.side = replacement.side;
+    executeOrder(orderBook, replacement, report, start);
+}
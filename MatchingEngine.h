@@ -3,14 +3,132 @@
 
 #include "OrderBook.h"
 #include "Order.h"
+#include "Message.h"
+#include "MarketData.h"
+#include "PreTradeRisk.h"
+#include "Stats.h"
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
 
-class MatchingEngine {
+// Activity of one MatchingEngine. Written only by the thread that runs it.
+struct EngineStats {
+    LatencyHistogram match;                // Matching and resting one new order, logging excluded
+    std::atomic<uint64_t> orders{0};       // New orders, including replacements that re-enter
+    std::atomic<uint64_t> fills{0};
+    std::atomic<uint64_t> cancels{0};
+    std::atomic<uint64_t> replaces{0};
+    std::atomic<uint64_t> rejects{0};      // Requests that threw
+    std::atomic<uint64_t> expired{0};      // Market, IOC and FOK orders cancelled with quantity unfilled
+    std::atomic<uint64_t> restingOrders{0};
+    std::atomic<uint64_t> bookLevels{0};   // Price levels across every book and side
+    uint64_t startedAt = nowNs();
+};
+
+// Matches orders for a set of instruments on the calling thread. Each symbol has
+// its own OrderBook; all of them draw on one preallocated BookMemory.
+class MatchingEngine : public OrderHandler {
 private:
-    OrderBook orderBook;
+    BookMemory memory;    // Preallocated levels and orders; declared first so it outlives the books
+    std::vector<std::unique_ptr<OrderBook>> books;  // Indexed by symbol ID
+    EngineStats stats;
+
+    // Where and as which part snapshots are written; empty when they are off
+    std::string snapshotDir;
+    uint32_t snapshotPart = 0;
+    uint32_t snapshotParts = 1;
+    pid_t snapshotChild = -1;          // Writer still running, -1 if none
+    uint64_t snapshotSequence = 0;     // Sequence it is writing
+
+    std::unique_ptr<MarketDataPublisher> marketData;  // Null when the feed is off
+    int64_t priceBand = 0;             // Ticks a market order may trade through the touch, 0 for no limit
+    std::unique_ptr<PreTradeRisk> risk;               // Null when risk checks are off
+    bool replaying = false;            // Journaled requests passed the risk checks when first taken
+
+    // Throws std::invalid_argument for a symbol ID without a book
+    OrderBook& bookFor(uint32_t symbolId);
+
+    // Worst price a market order on `side` may trade at: the opposing touch
+    // moved by the price band
+    int64_t marketLimit(const OrderBook& book, char side) const;
+
+    // Runs the risk checks on a new order, unless off or replaying
+    void checkRisk(const OrderBook& book, const Order& order, uint64_t now);
+
+    // Matches an order that has passed every check and rests what is left, or
+    // cancels it if the books are out of capacity. Throws nothing once matching starts.
+    // `start` is when matching began, for the latency histogram.
+    void executeOrder(OrderBook& book, Order order, ExecutionReport& report, uint64_t start);
+
+    // Collects a finished snapshot writer, or waits for it. Returns false if one
+    // is still running.
+    bool reapSnapshot(bool wait);
 
 public:
-    void processOrder(Order order);
+    // `ladders` gives each symbol ID's dense price range; symbols past its end keep
+    // all their levels in trees
+    explicit MatchingEngine(const BookCapacity& capacity = BookCapacity(), size_t symbolCount = 1,
+                            const std::vector<LadderConfig>& ladders = {});
+    ~MatchingEngine();
+
+    // Dispatches a decoded request to the matching handler below
+    void processMessage(const OrderMessage& message, ExecutionReport& report) override;
+
+    // Journal replay: as processMessage, with the risk checks skipped but their
+    // positions still kept
+    void replayMessage(const OrderMessage& message, ExecutionReport& report) override;
+
+    // Publishes the market-data update collected so far when conflating by batch
+    void commit() override;
+
+    // "match:" latency line and an "engine:" line with counters, book size and orders/s,
+    // then a "risk:" line when risk checks are on
+    std::string statsReport() const override;
+
+    // Each handler appends its fills to `report` and sets its open quantity. A
+    // market, IOC or unfillable FOK order reports what it did not trade as cancelled.
+    void processOrder(Order order, ExecutionReport& report);
+    void cancelOrder(uint32_t symbolId, OrderId orderId, ExecutionReport& report);
+    void replaceOrder(uint32_t symbolId, OrderId orderId, int64_t price, int quantity, ExecutionReport& report);
+
+    // Publishes level changes and trades of every later request as stream `streamId`.
+    // Throws std::runtime_error if the socket cannot be set up.
+    void enableMarketData(const MarketDataConfig& config, uint16_t streamId = 0);
+
+    // Market orders trade no more than `ticks` through the opposing touch they
+    // arrive at; 0 lets them sweep the whole side
+    void setPriceBand(int64_t ticks) { priceBand = ticks; }
+
+    // Checks every later new order against `limits` (which must outlive the engine)
+    // and rejects breaches with RiskRejection. `tickSizes` values notional by
+    // symbol ID. Call before loading a snapshot, so its orders count as working.
+    // Without `checkRate` the max-rate limit is ignored, for runs off the wall clock.
+    void enableRisk(const RiskLimits& limits, const std::vector<double>& tickSizes, bool checkRate = true);
+
+    // Snapshots go to `dir` as part `part` of `parts` (one per shard)
+    void enableSnapshots(const std::string& dir, uint32_t part = 0, uint32_t parts = 1);
+
+    // Calls fn(order) for every resting order: books by symbol ID, then as
+    // OrderBook::forEachOrder
+    template <typename Fn>
+    void forEachOrder(Fn fn) const {
+        for (const auto& book : books) {
+            book->forEachOrder(fn);
+        }
+    }
+
+    // Forks a child that writes every book to a snapshot tagged `sequence` and
+    // returns at once; the child works on a copy-on-write image of the books, so
+    // matching only pauses for the fork itself. Throws std::runtime_error if
+    // snapshots are off or the previous one is still being written.
+    void writeSnapshot(uint64_t sequence);
+
+    // Fills the (empty) books from this engine's part of snapshot `sequence`.
+    // Throws std::runtime_error if the file does not match this engine.
+    void loadSnapshot(uint64_t sequence);
 };
 
 #endif // MATCHINGENGINE_H
@@ -0,0 +1,59 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include "Order.h"
+#include "Execution.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Kinds of inbound requests accepted on the wire
+enum class MessageType {
+    NewOrder,   // Add a new order
+    Cancel,     // Cancel a resting order
+    Replace,    // Cancel/replace a resting order with a new price and quantity
+    Snapshot    // Write the books to disk; sequence is the last journal record applied
+};
+
+// A decoded inbound request. Every type carries order.symbolId. Cancel uses only
+// order.orderId; Replace uses order.orderId, order.price and order.quantity (the
+// new open quantity). Snapshot uses only sequence, which the journal fills in.
+struct OrderMessage {
+    MessageType type;
+    Order order;
+    uint64_t sequence;  // Client sequence number from the binary protocol, 0 for text messages;
+                        // for Snapshot, the journal position
+
+    OrderMessage() : type(MessageType::NewOrder), order(), sequence(0) {}
+    OrderMessage(MessageType t, const Order& o, uint64_t seq = 0) : type(t), order(o), sequence(seq) {}
+};
+
+// Anything that consumes decoded requests: the matching engine itself, or a
+// front end that hands them on to matching threads. Rejections are thrown.
+class OrderHandler {
+public:
+    virtual ~OrderHandler() = default;
+
+    // Clears `report` and fills it in with the outcome of the request
+    virtual void processMessage(const OrderMessage& message, ExecutionReport& report) = 0;
+
+    // Re-applies a journaled request during recovery. Requests rejected when first
+    // received are flagged in the journal and never reach here; a rejection now
+    // leaves the books as they were, so it is ignored.
+    virtual void replayMessage(const OrderMessage& message, ExecutionReport& report) {
+        try {
+            processMessage(message, report);
+        } catch (const std::exception&) {
+        }
+    }
+
+    // Called by the front end before it sends the replies for what it has handed
+    // over so far; a journaling handler makes those requests durable here
+    virtual void commit() {}
+
+    // Counters and latency summary, one "name: ..." line per group. Safe to call
+    // from any thread while messages are being processed.
+    virtual std::string statsReport() const = 0;
+};
+
+#endif // MESSAGE_H
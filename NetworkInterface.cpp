@@ -1,7 +1,62 @@
 #include "NetworkInterface.h"
+#include "CpuAffinity.h"
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cinttypes>
+#include <cerrno>
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+// Reads a wire struct from the receive buffer. The memcpy keeps the access
+// well-defined for an unaligned char buffer and compiles down to plain loads.
+template <typename T>
+T load(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// Copies a text reply into the reply slot, truncating it to fit
+size_t copyResponse(const std::string& text, char* response) {
+    size_t length = std::min(text.size(), NetworkInterface::MAX_RESPONSE);
+    std::memcpy(response, text.data(), length);
+    return length;
+}
+
+// Decimal places needed to print multiples of the tick size exactly
+int tickDecimals(double tickSize) {
+    int decimals = 0;
+    double scaled = tickSize;
+    while (decimals < 8 && std::fabs(scaled - std::round(scaled)) > 1e-9) {
+        scaled *= 10.0;
+        ++decimals;
+    }
+    return decimals;
+}
+
+// Mean of a range of latencies
+uint64_t mean(std::vector<uint64_t>::const_iterator first, std::vector<uint64_t>::const_iterator last) {
+    uint64_t sum = 0;
+    for (auto it = first; it != last; ++it) {
+        sum += *it;
+    }
+    return first == last ? 0 : sum / static_cast<uint64_t>(last - first);
+}
+
+} // namespace
 
 // Constructor: Initializes the socket and binds it to the given port
-NetworkInterface::NetworkInterface(int port) : port(port), isRunning(true) {
+NetworkInterface::NetworkInterface(int port, const SymbolDirectory& symbols)
+    : socket_fd(-1), port(port), symbols(symbols), isRunning(true), wireFormat(WireFormat::Auto), batchSize(1),
+      busyPoll(false) {
+    if (port < 0) {
+        return;
+    }
+
     // Create a UDP socket
     socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (socket_fd < 0) {
@@ -22,7 +77,9 @@ NetworkInterface::NetworkInterface(int port) : port(port), isRunning(true) {
 
 // Destructor: Cleans up the socket
 NetworkInterface::~NetworkInterface() {
-    close(socket_fd);
+    if (socket_fd >= 0) {
+        close(socket_fd);
+    }
 }
 
 // Prepares the socket for communication (used for initialization)
@@ -32,101 +89,677 @@ void NetworkInterface::prepareSocket() {
     }
 }
 
+void NetworkInterface::setBatchSize(size_t size) {
+    if (size == 0 || size > 1024) {
+        throw std::invalid_argument("Batch size must be between 1 and 1024.");
+    }
+    batchSize = size;
+}
+
 // Gracefully stops the network interface
 void NetworkInterface::stop() {
     isRunning = false;
 }
 
-// Receives and processes incoming orders from clients
-void NetworkInterface::receiveOrders(MatchingEngine& engine) {
-    std::vector<char> buffer(1024);  // Buffer to store incoming data
-    Logger& logger = Logger::getInstance();
+// Sets SO_RCVTIMEO so blocking receives wake up periodically to notice a stop
+// requested from another thread
+void NetworkInterface::setReceiveTimeout(int milliseconds) {
+    timeval timeout{};
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+        throw std::runtime_error("Failed to set receive timeout.");
+    }
+}
 
-    while (isRunning) {
-        sockaddr_in clientAddr;
-        socklen_t addrLen = sizeof(clientAddr);
-
-        // Receive data from the client
-        int bytesReceived = recvfrom(socket_fd, buffer.data(), buffer.size(), 0, (struct sockaddr*)&clientAddr, &addrLen);
-        if (bytesReceived < 0) {
-            if (isRunning) {
-                logger.log("Error: Failed to receive data.");
+bool NetworkInterface::setReceiveBuffer(int bytes) {
+    return setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) == 0 ||
+           setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) == 0;
+}
+
+bool NetworkInterface::setSocketBusyPoll(int microseconds) {
+    return setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) == 0;
+}
+
+int NetworkInterface::receiveBufferBytes() const {
+    int bytes = 0;
+    socklen_t length = sizeof(bytes);
+    getsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &bytes, &length);
+    return bytes;
+}
+
+int NetworkInterface::socketBusyPollMicroseconds() const {
+    int microseconds = 0;
+    socklen_t length = sizeof(microseconds);
+    getsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &microseconds, &length);
+    return microseconds;
+}
+
+double NetworkInterface::measureEmptyPollNs(int polls) const {
+    char byte;
+    uint64_t start = nowNs();
+    for (int i = 0; i < polls; ++i) {
+        recv(socket_fd, &byte, sizeof(byte), MSG_DONTWAIT | MSG_PEEK);
+    }
+    return static_cast<double>(nowNs() - start) / polls;
+}
+
+// Receives up to `count` datagrams into the buffers described by `msgs`. A single
+// slot uses recvfrom, more use recvmmsg. Returns the number received, 0 if nothing
+// arrived (busy-poll miss, timeout or error). A datagram cut short to fit its slot
+// is given a length past the slot's, for decodeDatagram to reject.
+int NetworkInterface::receiveBatch(mmsghdr* msgs, size_t count) {
+    // Busy polling never sleeps in the kernel; otherwise block until at least one
+    // datagram arrives and then take whatever else is already queued
+    const int flags = busyPoll ? MSG_DONTWAIT : (count > 1 ? MSG_WAITFORONE : 0);
+
+    int received;
+    if (count == 1) {
+        msghdr& header = msgs[0].msg_hdr;
+        socklen_t addrLen = sizeof(sockaddr_in);
+        // MSG_TRUNC makes recvfrom return the datagram's full length
+        received = recvfrom(socket_fd, header.msg_iov->iov_base, header.msg_iov->iov_len, flags | MSG_TRUNC,
+                            static_cast<sockaddr*>(header.msg_name), &addrLen);
+        if (received >= 0) {
+            msgs[0].msg_len = received;
+            header.msg_namelen = addrLen;
+            received = 1;
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+        received = recvmmsg(socket_fd, msgs, count, flags, nullptr);
+        for (int i = 0; i < received; ++i) {
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                msgs[i].msg_len = static_cast<unsigned>(msgs[i].msg_hdr.msg_iov->iov_len) + 1;
             }
-            continue;  // Skip processing on error
         }
+    }
+
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && isRunning) {
+            Logger::getInstance().log("Error: Failed to receive data.", LogLevel::Error);
+        }
+        return 0;
+    }
+    return received;
+}
+
+// Sends the prepared replies, one sendto for a single reply and sendmmsg otherwise
+void NetworkInterface::sendBatch(mmsghdr* msgs, size_t count) {
+    if (count == 1) {
+        const msghdr& header = msgs[0].msg_hdr;
+        sendto(socket_fd, header.msg_iov->iov_base, header.msg_iov->iov_len, 0,
+               static_cast<const sockaddr*>(header.msg_name), header.msg_namelen);
+        return;
+    }
+    for (size_t sent = 0; sent < count;) {
+        int n = sendmmsg(socket_fd, msgs + sent, count - sent, 0);
+        if (n <= 0) {
+            Logger::getInstance().log("Error: Failed to send replies.", LogLevel::Error);
+            break;
+        }
+        sent += n;
+    }
+}
+
+NetworkInterface::DatagramBatch::DatagramBatch(size_t size)
+    : size(size), buffers(size * (MAX_DATAGRAM + 1)), responses(size * MAX_RESPONSE), clientAddrs(size),
+      recvIov(size), sendIov(size), recvMsgs(size), sendMsgs(size) {
+    for (size_t i = 0; i < size; ++i) {
+        recvIov[i].iov_base = &buffers[i * (MAX_DATAGRAM + 1)];
+        recvIov[i].iov_len = MAX_DATAGRAM;
+        recvMsgs[i].msg_hdr = msghdr{};
+        recvMsgs[i].msg_hdr.msg_iov = &recvIov[i];
+        recvMsgs[i].msg_hdr.msg_iovlen = 1;
+        recvMsgs[i].msg_hdr.msg_name = &clientAddrs[i];
+    }
+}
+
+// Receives and processes incoming orders from clients until a shutdown request.
+// With a local transport both sources are polled in turn, spinning while either
+// has work and yielding the CPU once both have been idle for a while.
+void NetworkInterface::receiveOrders(OrderHandler& engine) {
+    DatagramBatch batch(batchSize);
+    int idleSpins = 0;
+    while (isRunning) {
+        size_t served = serveBatch(batch, engine);
+        if (!localTransport) {
+            continue;
+        }
+        served += localTransport(engine);
+        if (served > 0) {
+            idleSpins = 0;
+        } else if (++idleSpins < SPINS_BEFORE_YIELD) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    Logger::getInstance().log("Server has stopped.");
+}
+
+// With a batch size above one, each recvmmsg call drains up to that many queued
+// datagrams, they are matched in order, and all replies go out in a single
+// sendmmsg call.
+int NetworkInterface::serveBatch(DatagramBatch& batch, OrderHandler& engine) {
+    int received = receiveBatch(batch.recvMsgs.data(), batch.size);
+    uint64_t receivedAt = nowNs();
+
+    // Process the batch in arrival order, collecting one reply per datagram
+    int replies = 0;
+    for (int i = 0; i < received && isRunning; ++i) {
+        char* response = &batch.responses[replies * MAX_RESPONSE];
+        size_t responseLength = handleDatagram(static_cast<char*>(batch.recvIov[i].iov_base),
+                                               batch.recvMsgs[i].msg_len, engine, response);
+        if (responseLength == 0) {
+            continue;
+        }
+        batch.sendIov[replies].iov_base = response;
+        batch.sendIov[replies].iov_len = responseLength;
+        batch.sendMsgs[replies].msg_hdr = msghdr{};
+        batch.sendMsgs[replies].msg_hdr.msg_iov = &batch.sendIov[replies];
+        batch.sendMsgs[replies].msg_hdr.msg_iovlen = 1;
+        batch.sendMsgs[replies].msg_hdr.msg_name = &batch.clientAddrs[i];
+        batch.sendMsgs[replies].msg_hdr.msg_namelen = batch.recvMsgs[i].msg_hdr.msg_namelen;
+        ++replies;
+    }
+
+    if (replies) {
+        engine.commit();  // Nothing is acknowledged before it is journaled
+        sendBatch(batch.sendMsgs.data(), replies);
+        for (int i = 0; i < replies; ++i) {
+            recordReply(receivedAt);
+        }
+    }
+    return received;
+}
+
+// Handles one datagram. `data` has room for a terminator at data[length].
+// Writes the reply into `response` and returns its length, or 0 for no reply.
+size_t NetworkInterface::handleDatagram(char* data, size_t length, OrderHandler& engine, char* response) {
+    OrderMessage message;
+    size_t responseLength = 0;
+    if (!decodeDatagram(data, length, message, response, responseLength)) {
+        return responseLength;
+    }
+    return executeMessage(message, data, length, engine, response);
+}
+
+// Writes a binary acknowledgement echoing the request's header, then as many of
+// the fills as fit in one reply
+size_t NetworkInterface::writeAck(const char* data, size_t length, OrderId orderId, bool accepted, char* response,
+                                  const ExecutionReport* executed) const {
+    constexpr size_t MAX_FILLS = (MAX_RESPONSE - sizeof(WireAck)) / sizeof(WireFill);
+
+    WireAck ack{};
+    if (length >= sizeof(WireHeader)) {
+        ack.header = load<WireHeader>(data);
+    }
+    ack.header.magic = PROTOCOL_MAGIC;
+    ack.header.version = PROTOCOL_VERSION;
+    ack.header.type = static_cast<uint8_t>(WireType::Ack);
+    ack.orderId = orderId;
+    ack.accepted = accepted ? 1 : 0;
+
+    size_t fillCount = 0;
+    if (executed) {
+        ack.openQuantity = executed->openQuantity;
+        ack.flags = executed->queued ? ACK_QUEUED : 0;
+        if (executed->cancelledQuantity > 0) {
+            ack.flags |= ACK_CANCELLED;
+        }
+        fillCount = std::min(executed->fills.size(), MAX_FILLS);
+        if (fillCount < executed->fills.size()) {
+            ack.flags |= ACK_TRUNCATED;
+        }
+        for (size_t i = 0; i < fillCount; ++i) {
+            const Fill& fill = executed->fills[i];
+            WireFill wire{fill.makerId, fill.price, fill.quantity, fill.takerRemaining, fill.makerRemaining};
+            std::memcpy(response + sizeof(WireAck) + i * sizeof(WireFill), &wire, sizeof(wire));
+        }
+    }
+    ack.fillCount = static_cast<uint16_t>(fillCount);
+
+    std::memcpy(response, &ack, sizeof(ack));
+    return sizeof(ack) + fillCount * sizeof(WireFill);
+}
 
-        buffer[bytesReceived] = '\0';  // Null-terminate the received string
-        std::string orderStr(buffer.data());
+// Text reply: "Order processed successfully." (or "Order queued for matching."),
+// then "Fill: ..." per execution, "Resting: <quantity>" if any is left on the book
+// and "Cancelled: <quantity>" if an order that may not rest did not fill completely.
+// Prices are printed in the instrument's units, as the client sent them.
+size_t NetworkInterface::writeReport(const ExecutionReport& executed, uint32_t symbolId, char* response) const {
+    if (executed.queued) {
+        return copyResponse("Order queued for matching.", response);
+    }
+
+    size_t length = copyResponse("Order processed successfully.", response);
+    const double tickSize = symbols.at(symbolId).tickSize;
+    const int decimals = tickDecimals(tickSize);
+    char line[128];
+
+    // Appends a line if it fits, returning false otherwise
+    auto append = [&](int lineLength) {
+        if (lineLength < 0 || length + lineLength > MAX_RESPONSE) {
+            return false;
+        }
+        std::memcpy(response + length, line, lineLength);
+        length += lineLength;
+        return true;
+    };
 
-        // Check for shutdown command
-        if (orderStr == "shutdown") {
-            logger.log("Shutdown command received. Stopping server...");
-            isRunning = false;
+    // Leave room for the last line, which reports any fills that did not fit
+    constexpr size_t SUMMARY_ROOM = 48;
+    size_t written = 0;
+    for (const Fill& fill : executed.fills) {
+        if (length + SUMMARY_ROOM > MAX_RESPONSE) {
             break;
         }
+        int lineLength = std::snprintf(line, sizeof(line), "\nFill: taker=%" PRId64 " maker=%" PRId64 " price=%.*f quantity=%d remaining=%d",
+                                       fill.takerId, fill.makerId, decimals, fill.price * tickSize,
+                                       fill.quantity, fill.takerRemaining);
+        if (!append(lineLength)) {
+            break;
+        }
+        ++written;
+    }
+    if (written < executed.fills.size()) {
+        append(std::snprintf(line, sizeof(line), "\n... %zu more fills", executed.fills.size() - written));
+    }
+    if (executed.openQuantity > 0) {
+        append(std::snprintf(line, sizeof(line), "\nResting: %d", executed.openQuantity));
+    }
+    if (executed.cancelledQuantity > 0) {
+        append(std::snprintf(line, sizeof(line), "\nCancelled: %d", executed.cancelledQuantity));
+    }
+    return length;
+}
+
+// "Execution: order=<id> side=<B|S> price=<price> quantity=<qty> remaining=<open> contra=<id>"
+size_t NetworkInterface::writeExecution(const Fill& fill, OrderId orderId, OrderId contraId, int remaining, char side,
+                                        uint32_t symbolId, bool binary, char* response) const {
+    if (binary) {
+        WireExecution execution{};
+        execution.header.magic = PROTOCOL_MAGIC;
+        execution.header.version = PROTOCOL_VERSION;
+        execution.header.type = static_cast<uint8_t>(WireType::Execution);
+        execution.header.symbolId = symbolId;
+        execution.orderId = orderId;
+        execution.contraId = contraId;
+        execution.price = fill.price;
+        execution.quantity = fill.quantity;
+        execution.remaining = remaining;
+        execution.side = side;
+        std::memcpy(response, &execution, sizeof(execution));
+        return sizeof(execution);
+    }
+    const double tickSize = symbols.at(symbolId).tickSize;
+    int length = std::snprintf(response, MAX_RESPONSE,
+                               "Execution: order=%" PRId64 " side=%c price=%.*f quantity=%d remaining=%d contra=%" PRId64,
+                               orderId, side, tickDecimals(tickSize), fill.price * tickSize, fill.quantity, remaining,
+                               contraId);
+    return length > 0 ? static_cast<size_t>(length) : 0;
+}
+
+// Decodes one datagram. `data` has room for a terminator at data[length]. Control
+// commands and malformed requests are answered here: the reply goes into `response`
+// and false is returned. True means `message` is ready for executeMessage.
+bool NetworkInterface::decodeDatagram(char* data, size_t length, OrderMessage& message,
+                                      char* response, size_t& responseLength) {
+    uint64_t start = nowNs();
+    bool forEngine = false;
+    if (length > MAX_DATAGRAM) {
+        // Only the first MAX_DATAGRAM bytes were kept; the rest cannot be trusted to parse
+        const std::string error = "Datagram over " + std::to_string(MAX_DATAGRAM) + " bytes";
+        Logger::getInstance().log(error + " rejected", LogLevel::Warn);
+        responseLength = isBinary(data, MAX_DATAGRAM) ? writeAck(data, MAX_DATAGRAM, 0, false, response)
+                                                      : copyResponse("Error processing order: " + error, response);
+    } else {
+        forEngine = decodeRequest(data, length, message, response, responseLength);
+    }
+    stats.parse.record(nowNs() - start);
+    relaxedAdd(stats.datagrams, 1);
+    return forEngine;
+}
+
+bool NetworkInterface::decodeRequest(char* data, size_t length, OrderMessage& message,
+                                     char* response, size_t& responseLength) {
+    Logger& logger = Logger::getInstance();
 
+    // Binary messages are decoded straight from the buffer and answered with a WireAck
+    if (isBinary(data, length)) {
         try {
-            // Parse and process the order
-            auto order = parseOrder(orderStr);
-            engine.processOrder(order);
+            message = decodeBinary(data, length);
+            return true;
+        } catch (const std::exception& e) {
+            uint64_t sequence = length >= sizeof(WireHeader) ? load<WireHeader>(data).sequence : 0;
+            logger.log("Binary message " + std::to_string(sequence) + " rejected: " + e.what(), LogLevel::Warn);
+            responseLength = writeAck(data, length, 0, false, response);
+            return false;
+        }
+    }
 
-            // Send a success response back to the client
-            std::string response = "Order processed successfully.";
-            sendto(socket_fd, response.c_str(), response.length(), 0, (struct sockaddr*)&clientAddr, addrLen);
+    data[length] = '\0';  // Null-terminate the received string
+    std::string orderStr(data);
+
+    // Check for shutdown command
+    if (orderStr == "shutdown") {
+        logger.log("Shutdown command received. Stopping server...");
+        isRunning = false;
+        responseLength = 0;
+        return false;
+    }
+
+    // Latency histograms and counters, read without pausing any thread
+    if (orderStr == "stats") {
+        responseLength = copyResponse(statsReport(), response);
+        return false;
+    }
+
+    // Runtime log level change: "loglevel <debug|info|warn|error|off>"
+    if (orderStr.rfind("loglevel ", 0) == 0) {
+        try {
+            logger.setLevel(Logger::parseLevel(orderStr.substr(9)));
+            responseLength = copyResponse("Log level updated.", response);
         } catch (const std::exception& e) {
-            // Send an error response to the client
-            std::string response = "Error processing order: " + std::string(e.what());
-            sendto(socket_fd, response.c_str(), response.length(), 0, (struct sockaddr*)&clientAddr, addrLen);
+            responseLength = copyResponse("Error: " + std::string(e.what()), response);
+        }
+        return false;
+    }
+
+    for (const auto& command : commands) {
+        if (orderStr == command.first) {
+            try {
+                responseLength = copyResponse(command.second(), response);
+            } catch (const std::exception& e) {
+                responseLength = copyResponse("Error: " + std::string(e.what()), response);
+            }
+            return false;
+        }
+    }
+
+    try {
+        // Parse the request
+        message = parseMessage(orderStr);
+        return true;
+    } catch (const std::exception& e) {
+        // Send an error response to the client
+        responseLength = copyResponse("Error processing order: " + std::string(e.what()), response);
+        return false;
+    }
+}
+
+// Hands a decoded request to the engine and writes the reply. `data` is the
+// datagram it was decoded from; binary replies echo its header.
+size_t NetworkInterface::executeMessage(const OrderMessage& message, const char* data, size_t length,
+                                        OrderHandler& engine, char* response) {
+    const bool binary = isBinary(data, length);
+    try {
+        engine.processMessage(message, report);
+        if (executionListener) {
+            executionListener(message, report);
+        }
+        if (message.type == MessageType::Snapshot) {
+            return copyResponse("Snapshot started.", response);
+        }
+        uint64_t start = nowNs();
+        size_t responseLength = binary ? writeAck(data, length, message.order.orderId, true, response, &report)
+                                       : writeReport(report, message.order.symbolId, response); // Execution report
+        stats.ack.record(nowNs() - start);
+        return responseLength;
+    } catch (const std::exception& e) {
+        if (binary) {
+            Logger::getInstance().log("Binary message " + std::to_string(message.sequence) + " rejected: " + e.what(),
+                                      LogLevel::Warn);
+            return writeAck(data, length, message.order.orderId, false, response);
+        }
+        // Send an error response to the client
+        return copyResponse("Error processing order: " + std::string(e.what()), response);
+    }
+}
+
+std::string NetworkInterface::statsReport() const {
+    std::ostringstream oss;
+    oss << "datagrams=" << stats.datagrams.load(std::memory_order_relaxed) << "\n"
+        << stats.parse.summary("parse") << "\n"
+        << stats.ack.summary("ack") << "\n"
+        << stats.wireToAck.summary("wireToAck") << "\n";
+    for (const auto& source : statsSources) {
+        oss << source();
+    }
+    return oss.str();
+}
+
+bool NetworkInterface::isBinary(const char* data, size_t length) const {
+    switch (wireFormat) {
+        case WireFormat::Ascii:
+            return false;
+        case WireFormat::Binary:
+            return true;
+        case WireFormat::Auto:
+            break;
+    }
+    return length >= sizeof(uint16_t) && load<uint16_t>(data) == PROTOCOL_MAGIC;
+}
+
+// Decodes a binary protocol message. Fields are read directly out of the receive
+// buffer; nothing is allocated and prices arrive already in ticks.
+OrderMessage NetworkInterface::decodeBinary(const char* data, size_t length) {
+    Logger& logger = Logger::getInstance();
+
+    if (length < sizeof(WireHeader)) {
+        throw std::invalid_argument("Truncated binary message");
+    }
+    WireHeader header = load<WireHeader>(data);
+    if (header.magic != PROTOCOL_MAGIC) {
+        throw std::invalid_argument("Bad protocol magic");
+    }
+    if (header.version != PROTOCOL_VERSION) {
+        throw std::invalid_argument("Unsupported protocol version " + std::to_string(header.version));
+    }
+    symbols.at(header.symbolId);  // Rejects unknown instruments
+
+    switch (static_cast<WireType>(header.type)) {
+        case WireType::NewOrder: {
+            if (length != sizeof(WireNewOrder)) {
+                throw std::invalid_argument("Bad new order message length");
+            }
+            WireNewOrder msg = load<WireNewOrder>(data);
+            validateOrder(msg.orderId, msg.side, static_cast<double>(msg.price), msg.quantity, msg.timestamp,
+                          msg.traderId, msg.isMarketOrder, logger);
+            if (msg.timeInForce > static_cast<uint8_t>(TimeInForce::FOK)) {
+                throw std::invalid_argument("Unknown time in force " + std::to_string(msg.timeInForce));
+            }
+            logger.logEvent(LogLevel::Debug, LogEvent::OrderParsed, msg.orderId, msg.side, msg.price,
+                            msg.quantity, msg.traderId, msg.timestamp, msg.isMarketOrder == 1);
+            return OrderMessage(MessageType::NewOrder,
+                                Order(msg.orderId, msg.side, msg.price, msg.quantity, msg.timestamp,
+                                      msg.traderId, msg.isMarketOrder == 1, header.symbolId,
+                                      static_cast<TimeInForce>(msg.timeInForce)),
+                                header.sequence);
         }
+        case WireType::Cancel: {
+            if (length != sizeof(WireCancel)) {
+                throw std::invalid_argument("Bad cancel message length");
+            }
+            Order order;
+            order.orderId = load<WireCancel>(data).orderId;
+            order.symbolId = header.symbolId;
+            return OrderMessage(MessageType::Cancel, order, header.sequence);
+        }
+        case WireType::Replace: {
+            if (length != sizeof(WireReplace)) {
+                throw std::invalid_argument("Bad replace message length");
+            }
+            WireReplace msg = load<WireReplace>(data);
+            if (msg.price <= 0 || msg.quantity <= 0) {
+                throw std::invalid_argument("Replace price and quantity must be greater than zero.");
+            }
+            Order order;
+            order.orderId = msg.orderId;
+            order.price = msg.price;
+            order.quantity = msg.quantity;
+            order.symbolId = header.symbolId;
+            return OrderMessage(MessageType::Replace, order, header.sequence);
+        }
+        default:
+            throw std::invalid_argument("Unknown message type " + std::to_string(header.type));
+    }
+}
+
+// Parses a request string. Cancels and replaces are tagged by a leading 'C' or 'R',
+// "snapshot" asks for a book snapshot; anything else is a new order.
+OrderMessage NetworkInterface::parseMessage(const std::string& messageStr) {
+    if (messageStr == "snapshot") {
+        return OrderMessage(MessageType::Snapshot, Order());
+    }
+    if (!messageStr.empty() && messageStr[0] == 'C') {
+        return parseCancel(messageStr);
+    }
+    if (!messageStr.empty() && messageStr[0] == 'R') {
+        return parseReplace(messageStr);
+    }
+    return OrderMessage(MessageType::NewOrder, parseOrder(messageStr));
+}
+
+uint32_t NetworkInterface::parseSymbol(std::istream& ss) const {
+    std::string symbol;
+    if (ss >> symbol) {
+        return symbols.idOf(symbol);
     }
+    return 0;
+}
+
+// Parses a cancel string: C <orderId> [symbol]
+OrderMessage NetworkInterface::parseCancel(const std::string& messageStr) {
+    Logger& logger = Logger::getInstance();
+    std::istringstream ss(messageStr);
+
+    char tag;
+    OrderId orderId;
 
-    logger.log("Server has stopped.");
+    if (!(ss >> tag >> orderId)) {
+        logger.log("Parsing Error: Malformed cancel string: " + messageStr, LogLevel::Warn);
+        throw std::invalid_argument("Malformed cancel string");
+    }
+
+    Order order;
+    order.orderId = orderId;
+    order.symbolId = parseSymbol(ss);
+    return OrderMessage(MessageType::Cancel, order);
 }
 
-// Parses an order string into an Order object
+// Parses a cancel/replace string: R <orderId> <price> <quantity> [symbol]
+OrderMessage NetworkInterface::parseReplace(const std::string& messageStr) {
+    Logger& logger = Logger::getInstance();
+    std::istringstream ss(messageStr);
+
+    char tag;
+    OrderId orderId;
+    int quantity;
+    double price;
+
+    if (!(ss >> tag >> orderId >> price >> quantity)) {
+        logger.log("Parsing Error: Malformed replace string: " + messageStr, LogLevel::Warn);
+        throw std::invalid_argument("Malformed replace string");
+    }
+
+    if (price <= 0.0 || quantity <= 0) {
+        std::string errorMsg = "Validation errors: \n- Replace price and quantity must be greater than zero.";
+        logger.log(errorMsg, LogLevel::Warn);
+        throw std::invalid_argument(errorMsg);
+    }
+
+    Order order;
+    order.orderId = orderId;
+    order.symbolId = parseSymbol(ss);
+    order.price = toTicks(price, symbols.at(order.symbolId).tickSize, logger);
+    order.quantity = quantity;
+    return OrderMessage(MessageType::Replace, order);
+}
+
+// Parses an order string into an Order object:
+// <orderId> <side> <price> <quantity> <timestamp> <traderId> <isMarketOrder> [DAY|IOC|FOK] [symbol]
 Order NetworkInterface::parseOrder(const std::string& orderStr) {
     Logger& logger = Logger::getInstance();
     std::istringstream ss(orderStr);
 
-    int orderId, quantity, timestamp, traderId;
+    OrderId orderId;
+    int64_t timestamp;
+    int quantity, traderId;
     char side;
     double price;
     int isMarketOrder;
 
     // Parse the order string
     if (!(ss >> orderId >> side >> price >> quantity >> timestamp >> traderId >> isMarketOrder)) {
-        logger.log("Parsing Error: Malformed order string: " + orderStr);
+        logger.log("Parsing Error: Malformed order string: " + orderStr, LogLevel::Warn);
         throw std::invalid_argument("Malformed order string");
     }
 
+    // Optional time in force, then the optional symbol
+    TimeInForce timeInForce = TimeInForce::Day;
+    uint32_t symbolId = 0;
+    std::string token;
+    if (ss >> token) {
+        if (token == "DAY" || token == "IOC" || token == "FOK") {
+            timeInForce = token == "IOC" ? TimeInForce::IOC : token == "FOK" ? TimeInForce::FOK : TimeInForce::Day;
+            symbolId = parseSymbol(ss);
+        } else {
+            symbolId = symbols.idOf(token);
+        }
+    }
+
     // Validate the parsed order
     validateOrder(orderId, side, price, quantity, timestamp, traderId, isMarketOrder, logger);
+    int64_t priceTicks = toTicks(price, symbols.at(symbolId).tickSize, logger);
+
+    logger.logEvent(LogLevel::Debug, LogEvent::OrderParsed, orderId, side, priceTicks, quantity,
+                    traderId, timestamp, isMarketOrder == 1);
+
+    return Order(orderId, side, priceTicks, quantity, timestamp, traderId, isMarketOrder == 1, symbolId,
+                 timeInForce);
+}
+
+// Converts a validated positive price to ticks. This is the only place a floating
+// point price is used; matching and logging work on the integer tick count.
+int64_t NetworkInterface::toTicks(double price, double tickSize, Logger& logger) const {
+    double ticks = price / tickSize;
+
+    if (ticks >= 9.0e15) {  // Beyond the range doubles represent exactly
+        std::string errorMsg = "Price out of range: " + std::to_string(price);
+        logger.log(errorMsg, LogLevel::Warn);
+        throw std::invalid_argument(errorMsg);
+    }
 
-    logger.log("Order parsed successfully: ID=" + std::to_string(orderId) +
-               ", Side=" + std::string(1, side) +
-               ", Price=" + std::to_string(price) +
-               ", Quantity=" + std::to_string(quantity) +
-               ", Timestamp=" + std::to_string(timestamp) +
-               ", TraderID=" + std::to_string(traderId) +
-               ", MarketOrder=" + std::to_string(isMarketOrder));
+    double rounded = std::round(ticks);
+    if (std::fabs(ticks - rounded) > 1e-6) {
+        std::string errorMsg = "Price " + std::to_string(price) + " is not a multiple of the tick size " +
+                               std::to_string(tickSize);
+        logger.log(errorMsg, LogLevel::Warn);
+        throw std::invalid_argument(errorMsg);
+    }
 
-    return Order(orderId, side, price, quantity, timestamp, traderId, isMarketOrder == 1);
+    return static_cast<int64_t>(rounded);
 }
 
 // Validates order fields to ensure correctness
-void NetworkInterface::validateOrder(int orderId, char side, double price, int quantity, int timestamp, int traderId, int isMarketOrder, Logger& logger) {
+void NetworkInterface::validateOrder(OrderId orderId, char side, double price, int quantity, int64_t timestamp, int traderId, int isMarketOrder, Logger& logger) {
     std::vector<std::string> errors;
 
-    (void)orderId;  // Suppress unused parameter warning
-    (void)traderId; // Suppress unused parameter warning
+    (void)orderId;   // Suppress unused parameter warning
+    (void)timestamp; // Suppress unused parameter warning
+    (void)traderId;  // Suppress unused parameter warning
 
     // Validate side
     if (side != 'B' && side != 'S') {
         errors.push_back("Invalid side: must be 'B' or 'S'. Received: '" + std::string(1, side) + "'.");
     }
 
-    // Validate price
-    if (price <= 0.0) {
+    // Validate price; a market order may leave it 0, as it is not used
+    if (price < 0.0 || (price == 0.0 && isMarketOrder != 1)) {
         errors.push_back("Price must be greater than zero. Received: " + std::to_string(price));
     }
 
@@ -140,16 +773,117 @@ void NetworkInterface::validateOrder(int orderId, char side, double price, int q
         errors.push_back("isMarketOrder must be 0 or 1. Received: " + std::to_string(isMarketOrder));
     }
 
-    // Log timestamp for debugging
-    logger.log("Timestamp received: " + std::to_string(timestamp));
-
     // If there are errors, log and throw an exception
     if (!errors.empty()) {
         std::string errorMsg = "Validation errors: ";
         for (const auto& error : errors) {
             errorMsg += "\n- " + error;
         }
-        logger.log(errorMsg); // Log all errors
+        logger.log(errorMsg, LogLevel::Warn); // Log all errors
         throw std::invalid_argument(errorMsg);
     }
 }
+
+std::string NetworkInterface::warmUp(OrderHandler& engine, size_t orders) {
+    constexpr size_t WINDOW = 16;   // Requests per window when looking for the steady state
+    constexpr int64_t SPREAD = 32;  // Ticks either side of each instrument's mid price
+
+    std::vector<char> data(MAX_DATAGRAM + 1);
+    std::vector<char> response(MAX_RESPONSE);
+    std::vector<uint64_t> latencies(orders);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto random = [&state](uint64_t bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state % bound;
+    };
+
+    for (size_t i = 0; i < orders; ++i) {
+        const OrderId id = static_cast<OrderId>(i + 1);
+        const Instrument& instrument = symbols.at(static_cast<uint32_t>(i % symbols.size()));
+        const int64_t mid = instrument.ladderTicks ? instrument.ladderLow + static_cast<int64_t>(instrument.ladderTicks / 2)
+                                                   : 10000;
+        const int64_t price = mid + static_cast<int64_t>(random(2 * SPREAD + 1)) - SPREAD;
+        const int quantity = static_cast<int>(random(100)) + 1;
+        const char side = random(2) ? 'B' : 'S';
+        const OrderId earlier = id > 8 ? id - 1 - static_cast<OrderId>(random(8)) : 0;
+        const uint64_t kind = earlier ? random(10) : 0;  // 0-7 new order, 8 cancel, 9 replace
+        const bool ioc = kind == 7;
+        const bool binary = wireFormat == WireFormat::Binary || (wireFormat == WireFormat::Auto && i % 2);
+
+        size_t length;
+        if (binary) {
+            WireHeader header{PROTOCOL_MAGIC, PROTOCOL_VERSION, 0, instrument.symbolId, i};
+            if (kind == 8) {
+                header.type = static_cast<uint8_t>(WireType::Cancel);
+                WireCancel msg{header, earlier};
+                std::memcpy(data.data(), &msg, length = sizeof(msg));
+            } else if (kind == 9) {
+                header.type = static_cast<uint8_t>(WireType::Replace);
+                WireReplace msg{header, earlier, price, quantity};
+                std::memcpy(data.data(), &msg, length = sizeof(msg));
+            } else {
+                header.type = static_cast<uint8_t>(WireType::NewOrder);
+                WireNewOrder msg{header, id, price, static_cast<int64_t>(i), quantity, 1, side, 0,
+                                 static_cast<uint8_t>(ioc ? TimeInForce::IOC : TimeInForce::Day), 0};
+                std::memcpy(data.data(), &msg, length = sizeof(msg));
+            }
+        } else {
+            const int decimals = tickDecimals(instrument.tickSize);
+            const double units = price * instrument.tickSize;
+            const char* symbol = instrument.symbol.c_str();
+            int written;
+            if (kind == 8) {
+                written = std::snprintf(data.data(), MAX_DATAGRAM, "C %" PRId64 " %s", earlier, symbol);
+            } else if (kind == 9) {
+                written = std::snprintf(data.data(), MAX_DATAGRAM, "R %" PRId64 " %.*f %d %s", earlier, decimals,
+                                        units, quantity, symbol);
+            } else {
+                written = std::snprintf(data.data(), MAX_DATAGRAM, "%" PRId64 " %c %.*f %d %zu 1 0 %s %s", id, side,
+                                        decimals, units, quantity, i, ioc ? "IOC" : "DAY", symbol);
+            }
+            length = static_cast<size_t>(written);
+        }
+
+        uint64_t start = nowNs();
+        if (handleDatagram(data.data(), length, engine, response.data())) {
+            engine.commit();
+        }
+        latencies[i] = nowNs() - start;
+    }
+
+    // Start afresh: none of this was a client's request
+    stats.parse.reset();
+    stats.ack.reset();
+    stats.wireToAck.reset();
+    stats.datagrams.store(0, std::memory_order_relaxed);
+    report.clear();
+
+    std::ostringstream oss;
+    oss << "Warm-up: " << orders << " requests";
+    if (orders < 4 * WINDOW) {
+        return oss.str();
+    }
+
+    // Steady state is the mean of the second half. Means rather than medians, so
+    // the page faults and cache misses being warmed away count. The warm-up has
+    // converged at the end of the first window whose mean is within 10% of it.
+    const std::vector<uint64_t>& samples = latencies;
+    const uint64_t steady = mean(samples.begin() + orders / 2, samples.end());
+    size_t converged = orders;
+    for (size_t start = 0; start + WINDOW <= orders; start += WINDOW) {
+        if (mean(samples.begin() + start, samples.begin() + start + WINDOW) * 10 <= steady * 11) {
+            converged = start + WINDOW;
+            break;
+        }
+    }
+
+    oss << ", first " << samples[0] << "ns, steady state " << steady << "ns (mean of the last half), ";
+    if (converged < orders / 2) {
+        oss << "reached after " << converged << " requests";
+    } else {
+        oss << "not reached until the second half; consider a longer warm-up";
+    }
+    return oss.str();
+}
@@ -4,31 +4,192 @@
 #include <string>
 #include <atomic>
 #include <vector>
+#include <functional>
+#include <utility>
 #include <stdexcept>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include "Order.h"
+#include "Message.h"
+#include "Protocol.h"
 #include "Logger.h"
-#include "MatchingEngine.h"
+#include "SymbolDirectory.h"
+#include "Stats.h"
+
+// How a listener interprets incoming datagrams
+enum class WireFormat {
+    Auto,   // Binary if the datagram starts with PROTOCOL_MAGIC, text otherwise
+    Ascii,  // Text format only
+    Binary  // Binary protocol only
+};
+
+// Per-stage latencies of requests handled by a NetworkInterface. Each field is
+// written only by the thread that runs that stage, which differs with --pipeline.
+struct NetworkStats {
+    LatencyHistogram parse;              // Decoding and validating a datagram
+    LatencyHistogram ack;                // Writing the reply once the engine has returned
+    LatencyHistogram wireToAck;          // Datagram received to reply sent
+    std::atomic<uint64_t> datagrams{0};  // Datagrams decoded, including control commands and rejects
+};
+
+// Called by executeMessage with every request the engine accepted and its outcome
+using ExecutionListener = std::function<void(const OrderMessage&, const ExecutionReport&)>;
+
+// Serves requests from another source on the network thread, e.g. shared-memory
+// rings; returns how many it took
+using LocalTransport = std::function<size_t(OrderHandler&)>;
 
 // Manages network communication for receiving and processing orders
 class NetworkInterface {
 private:
     int socket_fd;                  // Network socket file descriptor
     int port;                       // Port the socket is bound to
+    const SymbolDirectory& symbols; // Symbol IDs and tick sizes; prices are converted to ticks on ingress
     std::atomic<bool> isRunning;    // Flag to control receiveOrders loop
+    WireFormat wireFormat;          // Accepted message format(s)
+    size_t batchSize;               // Datagrams drained per receive call; 1 uses recvfrom/sendto
+    bool busyPoll;                  // Spin on non-blocking receives instead of sleeping in the kernel
 
     // Validates order fields to ensure correctness
-    void validateOrder(int orderId, char side, double price, int quantity, int timestamp, int traderId, int isMarketOrder, Logger& logger);
+    void validateOrder(OrderId orderId, char side, double price, int quantity, int64_t timestamp, int traderId, int isMarketOrder, Logger& logger);
+
+    // Converts a client price to integer ticks, rejecting prices off the tick grid
+    int64_t toTicks(double price, double tickSize, Logger& logger) const;
+
+    // Reads the optional trailing symbol of a text message; the first instrument if absent
+    uint32_t parseSymbol(std::istream& ss) const;
+
+    OrderMessage parseCancel(const std::string& messageStr);  // "C <orderId> [symbol]"
+    OrderMessage parseReplace(const std::string& messageStr); // "R <orderId> <price> <quantity> [symbol]"
+
+    // Used by executeMessage only, so by one thread at a time
+    ExecutionReport report;
+
+    ExecutionListener executionListener;
+    LocalTransport localTransport;
+
+    NetworkStats stats;
+    std::vector<std::function<std::string()>> statsSources;  // Appended to statsReport()
+    std::vector<std::pair<std::string, std::function<std::string()>>> commands;  // Text control commands
+
+    // Writes a WireAck for the binary request in `data`, followed by the report's
+    // fills when one is given; returns the reply length
+    size_t writeAck(const char* data, size_t length, OrderId orderId, bool accepted, char* response,
+                    const ExecutionReport* executed = nullptr) const;
+
+    // Writes the text reply for an executed request: a status line and one line per fill
+    size_t writeReport(const ExecutionReport& executed, uint32_t symbolId, char* response) const;
+
+    // decodeDatagram without the timing
+    bool decodeRequest(char* data, size_t length, OrderMessage& message, char* response, size_t& responseLength);
+
+    // Processes one datagram and writes the reply into `response` (MAX_RESPONSE bytes).
+    // Returns the reply length, or 0 if nothing should be sent back.
+    size_t handleDatagram(char* data, size_t length, OrderHandler& engine, char* response);
 
 public:
-    explicit NetworkInterface(int port); // Constructor to initialize with a port
+    static constexpr size_t MAX_DATAGRAM = 1024;  // Largest request accepted
+    static constexpr size_t MAX_RESPONSE = 1472;  // One unfragmented datagram on a 1500-byte MTU; longer replies are truncated
+
+    // Receive and reply buffers for one recvmmsg/sendmmsg round of `size` datagrams
+    struct DatagramBatch {
+        size_t size;
+        std::vector<char> buffers;      // MAX_DATAGRAM plus a terminator per slot
+        std::vector<char> responses;    // MAX_RESPONSE per slot
+        std::vector<sockaddr_in> clientAddrs;
+        std::vector<iovec> recvIov, sendIov;
+        std::vector<mmsghdr> recvMsgs, sendMsgs;
+
+        explicit DatagramBatch(size_t size);
+    };
+
+    // Binds a UDP socket to `port` (0 for any free one). A negative port opens no
+    // socket, leaving only decoding and execution for offline use.
+    NetworkInterface(int port, const SymbolDirectory& symbols);
     ~NetworkInterface();                 // Destructor to clean up resources
 
     void prepareSocket();                      // Prepares the socket for communication
-    void receiveOrders(MatchingEngine& engine); // Receives and processes incoming orders
+    void receiveOrders(OrderHandler& engine);  // Receives and processes incoming orders
+    // One round of receiveOrders: receives, matches, commits and replies to up to
+    // batch.size datagrams. Returns how many were received.
+    int serveBatch(DatagramBatch& batch, OrderHandler& engine);
+    int getSocket() const { return socket_fd; }
     void stop();                               // Gracefully stops the network interface
     Order parseOrder(const std::string& orderStr); // Parses an order string into an Order object
+    OrderMessage parseMessage(const std::string& messageStr); // Parses a new order, cancel, replace or snapshot message
+    OrderMessage decodeBinary(const char* data, size_t length); // Decodes a binary protocol message in place
+    void setWireFormat(WireFormat format) { wireFormat = format; }
+    void setBatchSize(size_t size);              // Batched recvmmsg/sendmmsg when above 1
+    void setBusyPoll(bool enabled) { busyPoll = enabled; }
+    void setReceiveTimeout(int milliseconds);   // Bounds how long a blocking receive waits
+    size_t getBatchSize() const { return batchSize; }
+    bool getBusyPoll() const { return busyPoll; }
+    int getPort() const { return port; }
+
+    // Socket tuning. Each returns false if the kernel refused the setting; the
+    // getters report what is actually in effect.
+    bool setReceiveBuffer(int bytes);          // SO_RCVBUF, or SO_RCVBUFFORCE past rmem_max when permitted
+    bool setSocketBusyPoll(int microseconds);  // SO_BUSY_POLL: spin in the driver before sleeping on a receive
+    int receiveBufferBytes() const;            // As reported by the kernel, which doubles the requested size
+    int socketBusyPollMicroseconds() const;
+
+    // Nanoseconds an empty non-blocking receive takes, averaged over `polls`;
+    // the cost of each idle pass of a busy-polling receiver. Peeks, so nothing
+    // already queued is consumed.
+    double measureEmptyPollNs(int polls = 1000) const;
+    bool running() const { return isRunning; }
+
+    // Runs `orders` synthetic requests (new orders, IOC orders, cancels and
+    // replaces over every instrument, in each accepted wire format) through
+    // parsing, `engine` and reply encoding on the calling thread, without sending
+    // anything. Pass a throwaway engine: the point is to fault in buffers and warm
+    // caches and branch predictors on the thread that will serve clients.
+    // Latency statistics are reset afterwards. Returns a summary comparing the
+    // first request's latency with the steady state.
+    std::string warmUp(OrderHandler& engine, size_t orders);
+
+    // Adds a section to statsReport(), such as the engine's counters. Register every
+    // source before receiving starts; each must be safe to call from any thread.
+    void addStatsSource(std::function<std::string()> source) { statsSources.push_back(std::move(source)); }
+
+    // Adds a text control command: a datagram that is exactly `name` runs `handler`
+    // on the receiving thread and is answered with what it returns, or with
+    // "Error: ..." if it throws. Register every command before receiving starts.
+    void addCommand(const std::string& name, std::function<std::string()> handler) {
+        commands.emplace_back(name, std::move(handler));
+    }
+
+    // Stage latency histograms followed by every registered source. This is the
+    // reply to a "stats" datagram.
+    std::string statsReport() const;
+
+    // Records wire-to-ack latency for a reply just sent; `receivedAt` is from nowNs()
+    void recordReply(uint64_t receivedAt) { stats.wireToAck.record(nowNs() - receivedAt); }
+
+    // Building blocks for callers that split handleDatagram across threads (see OrderPipeline)
+    int receiveBatch(mmsghdr* msgs, size_t count); // Fills up to count datagrams; returns how many
+    void sendBatch(mmsghdr* msgs, size_t count);   // Sends count prepared replies
+    bool decodeDatagram(char* data, size_t length, OrderMessage& message,
+                        char* response, size_t& responseLength); // False if already answered, as is
+                                                                  // anything over MAX_DATAGRAM
+    size_t executeMessage(const OrderMessage& message, const char* data, size_t length,
+                          OrderHandler& engine, char* response);  // Returns the reply length
+    bool isBinary(const char* data, size_t length) const;  // By the wire format setting and the first bytes
+
+    // Polled between socket receives, which then must not block (see setBusyPoll).
+    // Set before receiving starts.
+    void setLocalTransport(LocalTransport transport) { localTransport = std::move(transport); }
+    size_t pollLocal(OrderHandler& engine) { return localTransport ? localTransport(engine) : 0; }
+    bool hasLocalTransport() const { return static_cast<bool>(localTransport); }
+
+    // Set before receiving starts; called on the thread running executeMessage
+    void setExecutionListener(ExecutionListener listener) { executionListener = std::move(listener); }
+
+    // Writes one execution of `orderId` (on `side`) against `contraId` as a
+    // WireExecution or an "Execution: ..." line; returns the length
+    size_t writeExecution(const Fill& fill, OrderId orderId, OrderId contraId, int remaining, char side,
+                          uint32_t symbolId, bool binary, char* response) const;
 };
 
 #endif // NETWORK_INTERFACE_H
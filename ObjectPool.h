@@ -0,0 +1,103 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <sys/mman.h>
+
+// Fixed-capacity slab of T with an intrusive free list. All memory is mapped and
+// pre-faulted up front, so create()/destroy() never touch the heap.
+template <typename T>
+class ObjectPool {
+private:
+    union Slot {
+        Slot* nextFree;                             // Link while the slot is free
+        alignas(T) unsigned char storage[sizeof(T)]; // Object while the slot is in use
+    };
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    Slot* slots;
+    Slot* freeList;
+    size_t capacity;
+    size_t inUse;
+    size_t mappedBytes;
+    bool hugePages;     // True if the slab is actually backed by huge pages
+
+public:
+    // Maps room for `capacity` objects. With `useHugePages` the slab is backed by
+    // 2 MB pages when the system has them reserved, and by normal pages otherwise.
+    explicit ObjectPool(size_t capacity, bool useHugePages = false)
+        : slots(nullptr), freeList(nullptr), capacity(capacity), inUse(0), mappedBytes(0), hugePages(false) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Pool capacity must be greater than zero.");
+        }
+
+        size_t bytes = capacity * sizeof(Slot);
+        void* memory = MAP_FAILED;
+
+        if (useHugePages) {
+            mappedBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            hugePages = memory != MAP_FAILED;
+        }
+        if (memory == MAP_FAILED) {
+            mappedBytes = bytes;
+            memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        }
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        // Thread every slot onto the free list, lowest address first
+        slots = static_cast<Slot*>(memory);
+        for (size_t i = capacity; i-- > 0;) {
+            slots[i].nextFree = freeList;
+            freeList = &slots[i];
+        }
+    }
+
+    ~ObjectPool() {
+        munmap(slots, mappedBytes);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Constructs a T in a free slot. Throws std::runtime_error when the pool is exhausted.
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (!freeList) {
+            throw std::runtime_error("Object pool exhausted.");
+        }
+        Slot* slot = freeList;
+        freeList = slot->nextFree;
+        ++inUse;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    // Destroys the object and returns its slot to the free list
+    void destroy(T* object) {
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->nextFree = freeList;
+        freeList = slot;
+        --inUse;
+    }
+
+    // Position of a live object's slot, in [0, capacity); lets callers keep
+    // parallel arrays of per-object data outside the slab
+    size_t indexOf(const T* object) const {
+        return static_cast<size_t>(reinterpret_cast<const Slot*>(object) - slots);
+    }
+
+    size_t size() const { return inUse; }
+    size_t available() const { return capacity - inUse; }
+    bool usingHugePages() const { return hugePages; }
+};
+
+#endif // OBJECT_POOL_H
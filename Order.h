@@ -2,20 +2,41 @@
 #define ORDER_H
 
 #include <string>
+#include <cstdint>
 
+// How long an order may stay on the book
+enum class TimeInForce : uint8_t {
+    Day = 0,   // Rests until filled or cancelled
+    IOC = 1,   // Immediate or cancel: fills what it can, the rest is cancelled
+    FOK = 2    // Fill or kill: fills completely at once or not at all
+};
+
+// Client-assigned order ID, unique within a matching engine
+using OrderId = int64_t;
+
+// A request's view of an order: everything the client sent. Resting orders are
+// not stored like this; the book splits them into a hot queue entry and a cold
+// record (see AVLTree::OrderEntry and OrderDetails).
 struct Order {
-    int orderId;          // Unique order ID
-    char side;            // 'B' for Buy, 'S' for Sell
-    double price;         // Order price
+    OrderId orderId;      // Unique order ID
+    int64_t price;        // Order price in ticks of the instrument's tick size
+    int64_t timestamp;    // Client timestamp, e.g. nanoseconds since the epoch
     int quantity;         // Quantity of the order
-    int timestamp;        // Timestamp (e.g., microseconds)
     int traderId;         // Trader ID
+    uint32_t symbolId;    // Instrument, as assigned by the SymbolDirectory
+    char side;            // 'B' for Buy, 'S' for Sell
     bool isMarketOrder;   // True if market order, false if limit order
+    TimeInForce timeInForce; // Market orders never rest, whatever this says
 
-    Order(int id, char s, double p, int q, int t, int trader, bool market = false)
-        : orderId(id), side(s), price(p), quantity(q), timestamp(t), traderId(trader), isMarketOrder(market) {}
+    Order(OrderId id, char s, int64_t p, int q, int64_t t, int trader, bool market = false, uint32_t symbol = 0,
+          TimeInForce tif = TimeInForce::Day)
+        : orderId(id), price(p), timestamp(t), quantity(q), traderId(trader), symbolId(symbol), side(s),
+          isMarketOrder(market), timeInForce(tif) {}
     
-    Order() : orderId(0), side('N'), price(0.0), quantity(0), timestamp(0), traderId(0), isMarketOrder(false) {}
+    Order() : orderId(0), price(0), timestamp(0), quantity(0), traderId(0), symbolId(0), side('N'),
+              isMarketOrder(false), timeInForce(TimeInForce::Day) {}
 };
 
+static_assert(sizeof(Order) == 40, "Order layout changed");
+
 #endif // ORDER_H
@@ -1,92 +1,158 @@
-#ifndef ORDER_BOOK_H
-#define ORDER_BOOK_H
-
-#include "Order.h"
-#include "AVLTree.h"
-#include "Logger.h" // Include the Logger
-#include <vector>
-#include <utility>
-
-class OrderBook {
-private:
-    AVLTree buyOrders;  // AVL tree for buy orders (sorted by descending price)
-    AVLTree sellOrders; // AVL tree for sell orders (sorted by ascending price)
-
-public:
-    // Add a new order to the book
-    void addOrder(const Order& order) {
-        if (order.side == 'B') {
-            buyOrders.insert(order.price, order);
-        } else if (order.side == 'S') {
-            sellOrders.insert(order.price, order);
+#include "OrderBook.h"
+#include "Logger.h"
+#include <algorithm>
+
+OrderBook::OrderBook(BookMemory& memory, uint32_t symbolId, const LadderConfig& ladder)
+    : memory(memory), symbolId(symbolId), buyOrders(memory.levels, ladder), sellOrders(memory.levels, ladder) {}
+
+// Returns this book's resting orders to the shared pools
+OrderBook::~OrderBook() {
+    for (PriceLadder* tree : {&buyOrders, &sellOrders}) {
+        for (AVLTree::Node* level = tree->lowestLevel(); level; level = tree->lowestLevel()) {
+            while (AVLTree::OrderEntry* entry = level->head) {
+                level->unlink(entry);
+                memory.index.erase(entry->orderId);
+                memory.orders.destroy(entry);
+            }
+            tree->remove(level->price);
         }
+    }
+}
+
+AVLTree::OrderEntry* OrderBook::findEntry(OrderId orderId) const {
+    AVLTree::OrderEntry* entry = memory.index.find(orderId);
+    return entry && memory.detailsOf(entry).symbolId == symbolId ? entry : nullptr;
+}
+
+// Add a new order to the book
+bool OrderBook::addOrder(const Order& order) {
+    if (order.side != 'B' && order.side != 'S') {
+        return false;
+    }
+    if (order.symbolId != symbolId || memory.index.find(order.orderId)) {
+        return false;
+    }
 
-        Logger::getInstance().log("Order added to book: ID = " + std::to_string(order.orderId) +
-                                  ", Side = " + (order.side == 'B' ? "Buy" : "Sell") +
-                                  ", Price = " + std::to_string(order.price) +
-                                  ", Quantity = " + std::to_string(order.quantity));
+    // Either step may run out of capacity; undo the entry so the book is unchanged
+    AVLTree::OrderEntry* entry = memory.orders.create(order.orderId, order.side, order.quantity);
+    memory.detailsOf(entry) = OrderDetails{order.timestamp, order.traderId, order.symbolId};
+    try {
+        memory.index.insert(order.orderId, entry);
+        try {
+            sideOf(order.side).insert(order.price, entry);
+        } catch (...) {
+            memory.index.erase(order.orderId);
+            throw;
+        }
+    } catch (...) {
+        memory.orders.destroy(entry);
+        throw;
     }
 
-    // Match an incoming order with existing orders in the book
-    std::pair<bool, Order> matchOrder(Order& incomingOrder) {
-        Logger& logger = Logger::getInstance();
-
-        if (incomingOrder.side == 'B') {
-            // Find the lowest sell order (price <= incoming price)
-            auto sellOrdersAtPrice = sellOrders.findLowestLessThanEqual(incomingOrder.price);
-            if (!sellOrdersAtPrice.empty()) {
-                Order matchedOrder = sellOrdersAtPrice.front(); // First order to match
-
-                logger.log("Matching Buy Order ID: " + std::to_string(incomingOrder.orderId) +
-                           " with Sell Order ID: " + std::to_string(matchedOrder.orderId));
-
-                // Match logic
-                if (incomingOrder.quantity >= matchedOrder.quantity) {
-                    incomingOrder.quantity -= matchedOrder.quantity;
-                    sellOrdersAtPrice.erase(sellOrdersAtPrice.begin()); // Remove fully matched order
-                } else {
-                    matchedOrder.quantity -= incomingOrder.quantity;
-                    incomingOrder.quantity = 0;
-                }
-
-                // Reinsert unmatched remaining orders
-                for (const auto& order : sellOrdersAtPrice) {
-                    sellOrders.insert(order.price, order);
-                }
-
-                return {true, matchedOrder};
+    Logger::getInstance().logEvent(LogLevel::Info, LogEvent::OrderAdded, order.orderId, order.side,
+                                   order.price, order.quantity);
+    return true;
+}
+
+void OrderBook::removeEntry(AVLTree::OrderEntry* entry) {
+    AVLTree::Node* level = entry->level;
+    level->unlink(entry);
+    if (level->empty()) {
+        sideOf(entry->side).remove(level->price);
+    }
+    memory.index.erase(entry->orderId);
+    memory.orders.destroy(entry);
+}
+
+// Sweeps the opposing side in one call. The best level is read from the side's
+// cached extreme, so moving on to the next level after one empties costs no search.
+size_t OrderBook::matchOrder(Order& incomingOrder, std::vector<Fill>& fills, bool makerTraders) {
+    Logger& logger = Logger::getInstance();
+    const size_t before = fills.size();
+
+    if (incomingOrder.side == 'B' || incomingOrder.side == 'S') {
+        bool isBuy = incomingOrder.side == 'B';
+        PriceLadder& opposingOrders = isBuy ? sellOrders : buyOrders;
+
+        while (incomingOrder.quantity > 0) {
+            // Best ask for a buy, best bid for a sell
+            AVLTree::Node* level = isBuy ? opposingOrders.lowestLevel() : opposingOrders.highestLevel();
+            bool crosses = level && (isBuy ? level->price <= incomingOrder.price
+                                           : level->price >= incomingOrder.price);
+            if (!crosses) {
+                break;
             }
-        } else if (incomingOrder.side == 'S') {
-            // Find the highest buy order (price >= incoming price)
-            auto buyOrdersAtPrice = buyOrders.findHighestGreaterThanEqual(incomingOrder.price);
-            if (!buyOrdersAtPrice.empty()) {
-                Order matchedOrder = buyOrdersAtPrice.front(); // First order to match
-
-                logger.log("Matching Sell Order ID: " + std::to_string(incomingOrder.orderId) +
-                           " with Buy Order ID: " + std::to_string(matchedOrder.orderId));
-
-                // Match logic
-                if (incomingOrder.quantity >= matchedOrder.quantity) {
-                    incomingOrder.quantity -= matchedOrder.quantity;
-                    buyOrdersAtPrice.erase(buyOrdersAtPrice.begin()); // Remove fully matched order
-                } else {
-                    matchedOrder.quantity -= incomingOrder.quantity;
-                    incomingOrder.quantity = 0;
-                }
-
-                // Reinsert unmatched remaining orders
-                for (const auto& order : buyOrdersAtPrice) {
-                    buyOrders.insert(order.price, order);
-                }
-
-                return {true, matchedOrder};
+
+            // Oldest order at the best price; only its hot half is touched
+            AVLTree::OrderEntry* restingEntry = level->head;
+
+            logger.logEvent(LogLevel::Debug, LogEvent::Matching, incomingOrder.orderId,
+                            incomingOrder.side, 0, 0, restingEntry->orderId);
+
+            int fillQuantity = std::min(incomingOrder.quantity, restingEntry->quantity);
+            incomingOrder.quantity -= fillQuantity;
+            restingEntry->quantity -= fillQuantity;
+            level->quantity -= fillQuantity;
+
+            fills.push_back(Fill{incomingOrder.orderId, restingEntry->orderId, level->price, fillQuantity,
+                                 incomingOrder.quantity, restingEntry->quantity,
+                                 makerTraders ? memory.detailsOf(restingEntry).traderId : 0});
+
+            // Remove the resting order once fully filled, and the level once empty
+            if (restingEntry->quantity == 0) {
+                removeEntry(restingEntry);
             }
         }
+    }
 
-        // No match found
-        logger.log("No match found for Order ID: " + std::to_string(incomingOrder.orderId));
-        return {false, Order()};
+    if (fills.size() == before) {
+        logger.logEvent(LogLevel::Debug, LogEvent::NoMatch, incomingOrder.orderId);
     }
-};
+    return fills.size() - before;
+}
 
-#endif // ORDER_BOOK_H
+bool OrderBook::cancelOrder(OrderId orderId) {
+    AVLTree::OrderEntry* entry = findEntry(orderId);
+    if (!entry) {
+        return false;
+    }
+    removeEntry(entry);
+    return true;
+}
+
+bool OrderBook::reduceOrder(OrderId orderId, int newQuantity) {
+    AVLTree::OrderEntry* entry = findEntry(orderId);
+    if (!entry || newQuantity <= 0 || newQuantity > entry->quantity) {
+        return false;
+    }
+    entry->level->quantity -= entry->quantity - newQuantity;
+    entry->quantity = newQuantity;
+    return true;
+}
+
+int64_t OrderBook::crossableQuantity(char side, int64_t price, int64_t wanted) const {
+    bool isBuy = side == 'B';
+    int64_t available = 0;
+    (isBuy ? sellOrders : buyOrders).forEachLevelWhile(!isBuy, [&](const AVLTree::Node& level) {
+        if (isBuy ? level.price > price : level.price < price) {
+            return false;
+        }
+        available += level.quantity;
+        return available < wanted;
+    });
+    return available;
+}
+
+int64_t OrderBook::levelQuantity(char side, int64_t price) const {
+    const AVLTree::Node* level = (side == 'B' ? buyOrders : sellOrders).find(price);
+    return level ? level->quantity : 0;
+}
+
+bool OrderBook::findOrder(OrderId orderId, Order& out) const {
+    const AVLTree::OrderEntry* entry = findEntry(orderId);
+    if (!entry) {
+        return false;
+    }
+    out = memory.orderOf(entry);
+    return true;
+}
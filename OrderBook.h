@@ -2,59 +2,136 @@
 #define ORDER_BOOK_H
 
 #include "Order.h"
+#include "Execution.h"
 #include "AVLTree.h"
+#include "PriceLadder.h"
+#include "ObjectPool.h"
+#include "OrderIndex.h"
+#include <cstddef>
 #include <vector>
 
+// Preallocated capacity for the order books of one matching engine
+struct BookCapacity {
+    size_t maxOrders = 1 << 18;    // Resting orders
+    size_t maxLevels = 1 << 16;    // Price levels, both sides together
+    bool useHugePages = false;     // Back the pools with 2 MB pages when available
+};
+
+// The fields of a resting order that matching never reads. They are only needed
+// to cancel, replace, snapshot or report the order, so they are kept out of the
+// queue entries that a sweep walks.
+struct OrderDetails {
+    int64_t timestamp;
+    int32_t traderId;
+    uint32_t symbolId;
+};
+
+// Slab storage for levels and resting orders, sized once at startup and shared by
+// all the order books of one matching engine. Order IDs are indexed across those
+// books, so an ID must be unique within the engine, not just within a symbol.
+struct BookMemory {
+    AVLTree::NodePool levels;
+    ObjectPool<AVLTree::OrderEntry> orders;
+    std::vector<OrderDetails> details;      // Cold half of each entry, by its slot in `orders`
+    OrderIndex<AVLTree::OrderEntry> index;  // Resting orders by order ID
+
+    explicit BookMemory(const BookCapacity& capacity)
+        : levels(capacity.maxLevels, capacity.useHugePages),
+          orders(capacity.maxOrders, capacity.useHugePages),
+          details(capacity.maxOrders),
+          index(capacity.maxOrders) {}
+
+    OrderDetails& detailsOf(const AVLTree::OrderEntry* entry) { return details[orders.indexOf(entry)]; }
+    const OrderDetails& detailsOf(const AVLTree::OrderEntry* entry) const { return details[orders.indexOf(entry)]; }
+
+    // Reassembles the full order from both halves of its entry
+    Order orderOf(const AVLTree::OrderEntry* entry) const {
+        const OrderDetails& cold = detailsOf(entry);
+        return Order(entry->orderId, entry->side, entry->level->price, entry->quantity, cold.timestamp,
+                     cold.traderId, false, cold.symbolId);
+    }
+};
+
+// The book of one instrument
 class OrderBook {
 private:
-    AVLTree buyOrders;  // AVL tree for buy orders (sorted by descending price)
-    AVLTree sellOrders; // AVL tree for sell orders (sorted by ascending price)
+    BookMemory& memory; // Owns the storage behind both trees and every resting order
+    uint32_t symbolId;  // Instrument this book trades
+    PriceLadder buyOrders;  // Buy price levels, best bid is the highest level
+    PriceLadder sellOrders; // Sell price levels, best ask is the lowest level
+
+    // This book's entry for the order ID, or nullptr
+    AVLTree::OrderEntry* findEntry(OrderId orderId) const;
+
+    PriceLadder& sideOf(char side) { return side == 'B' ? buyOrders : sellOrders; }
+
+    // Unlinks the entry from its level, drops the level if it empties, and
+    // returns the entry to the pool
+    void removeEntry(AVLTree::OrderEntry* entry);
 
 public:
-    // Add a new order to the book
-    void addOrder(const Order& order) {
-        if (order.side == 'B') {
-            buyOrders.insert(order.price, order);
-        } else if (order.side == 'S') {
-            sellOrders.insert(order.price, order);
-        }
-    }
+    // Both sides keep the levels in `ladder`'s range in a dense array and the rest
+    // in a tree; the default range is empty, so everything goes in the tree
+    OrderBook(BookMemory& memory, uint32_t symbolId, const LadderConfig& ladder = LadderConfig());
+    ~OrderBook();
 
-    // Match an incoming order with existing orders in the book
-    std::pair<bool, Order> matchOrder(Order& incomingOrder) {
-        if (incomingOrder.side == 'B') {
-            // Find the lowest sell order
-            auto sellOrdersAtPrice = sellOrders.find(incomingOrder.price);
-            if (!sellOrdersAtPrice.empty()) {
-                // Match with the first order at the price level
-                Order matchedOrder = sellOrdersAtPrice.front();
-                if (incomingOrder.quantity >= matchedOrder.quantity) {
-                    incomingOrder.quantity -= matchedOrder.quantity;
-                    sellOrdersAtPrice.erase(sellOrdersAtPrice.begin());
-                } else {
-                    matchedOrder.quantity -= incomingOrder.quantity;
-                    incomingOrder.quantity = 0;
-                }
-                return {true, matchedOrder};
-            }
-        } else if (incomingOrder.side == 'S') {
-            // Find the highest buy order
-            auto buyOrdersAtPrice = buyOrders.find(incomingOrder.price);
-            if (!buyOrdersAtPrice.empty()) {
-                // Match with the first order at the price level
-                Order matchedOrder = buyOrdersAtPrice.front();
-                if (incomingOrder.quantity >= matchedOrder.quantity) {
-                    incomingOrder.quantity -= matchedOrder.quantity;
-                    buyOrdersAtPrice.erase(buyOrdersAtPrice.begin());
-                } else {
-                    matchedOrder.quantity -= incomingOrder.quantity;
-                    incomingOrder.quantity = 0;
-                }
-                return {true, matchedOrder};
+    OrderBook(const OrderBook&) = delete;            // Queues link entries by address
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    // Add a new order to the book. Returns false if the order ID is already resting
+    // in any book sharing this book's memory.
+    // Throws std::runtime_error if the preallocated capacity is exhausted.
+    bool addOrder(const Order& order);
+
+    // Matches an incoming order against every opposing order it crosses, best price
+    // first and in time priority within a price. Each trade is appended to `fills`
+    // and the incoming order's quantity is reduced to what is still open. Returns
+    // the number of fills appended. With `makerTraders`, each fill also carries the
+    // maker's trader ID, read from the cold half of the resting order.
+    size_t matchOrder(Order& incomingOrder, std::vector<Fill>& fills, bool makerTraders = false);
+
+    // Removes a resting order in O(1). Returns false if the ID is not resting.
+    bool cancelOrder(OrderId orderId);
+
+    // Reduces the open quantity of a resting order in place, keeping its queue
+    // priority. Returns false if the ID is not resting or the quantity is not a reduction.
+    bool reduceOrder(OrderId orderId, int newQuantity);
+
+    // Copies the resting order with this ID into `out`. Returns false if it is not resting.
+    bool findOrder(OrderId orderId, Order& out) const;
+
+    // Calls fn(const Order&) for every resting order in priority order: bids best
+    // price first, then asks best price first, oldest first within a level.
+    // Adding the orders to an empty book in this order rebuilds it exactly.
+    template <typename Fn>
+    void forEachOrder(Fn fn) const {
+        auto level = [this, &fn](const AVLTree::Node& node) {
+            for (const AVLTree::OrderEntry* entry = node.head; entry; entry = entry->next) {
+                fn(memory.orderOf(entry));
             }
-        }
-        return {false, Order()}; // No match found
+        };
+        buyOrders.forEachLevel(true, level);
+        sellOrders.forEachLevel(false, level);
+    }
+
+    // Calls fn(side, price, quantity) for every level, bids then asks, best first
+    template <typename Fn>
+    void forEachLevel(Fn fn) const {
+        buyOrders.forEachLevel(true, [&fn](const AVLTree::Node& node) { fn('B', node.price, node.quantity); });
+        sellOrders.forEachLevel(false, [&fn](const AVLTree::Node& node) { fn('S', node.price, node.quantity); });
     }
+
+    // Opposing quantity an order on `side` with limit `price` could trade right now,
+    // counting no further than `wanted`. Reads the levels' cached totals, best price
+    // first, so it costs one step per level it needs.
+    int64_t crossableQuantity(char side, int64_t price, int64_t wanted) const;
+
+    // Total open quantity at a price on one side, 0 if there is no such level
+    int64_t levelQuantity(char side, int64_t price) const;
+
+    // Top of book, or nullptr when that side is empty
+    const AVLTree::Node* bestBid() const { return buyOrders.highestLevel(); }
+    const AVLTree::Node* bestAsk() const { return sellOrders.lowestLevel(); }
 };
 
 #endif // ORDER_BOOK_H
@@ -0,0 +1,103 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Open-addressing hash map from order ID to a resting order's entry. The table is
+// sized once at construction (at most half full) and never rehashes, so lookups,
+// inserts and erases are allocation-free. Erase uses backward-shift deletion, so
+// there are no tombstones to degrade probe lengths over a trading day.
+template <typename Entry>
+class OrderIndex {
+private:
+    struct Slot {
+        int64_t orderId;
+        Entry* entry;   // nullptr marks an empty slot
+    };
+
+    std::vector<Slot> table;
+    size_t mask;
+    size_t count;
+    size_t maxCount;
+
+    size_t home(int64_t orderId) const {
+        // Fibonacci hashing spreads sequential IDs across the table; the high half
+        // of the product depends on every bit of the ID
+        return static_cast<size_t>((static_cast<uint64_t>(orderId) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+
+public:
+    explicit OrderIndex(size_t maxEntries) : mask(0), count(0), maxCount(maxEntries) {
+        size_t size = 2;
+        while (size < maxEntries * 2)
+            size <<= 1;
+        table.assign(size, Slot{0, nullptr});
+        mask = size - 1;
+    }
+
+    Entry* find(int64_t orderId) const {
+        for (size_t i = home(orderId);; i = (i + 1) & mask) {
+            const Slot& slot = table[i];
+            if (!slot.entry)
+                return nullptr;
+            if (slot.orderId == orderId)
+                return slot.entry;
+        }
+    }
+
+    // Returns false if the ID is already present. Throws when the index is full.
+    bool insert(int64_t orderId, Entry* entry) {
+        if (count >= maxCount) {
+            throw std::runtime_error("Order index full.");
+        }
+        size_t i = home(orderId);
+        for (; table[i].entry; i = (i + 1) & mask) {
+            if (table[i].orderId == orderId)
+                return false;
+        }
+        table[i] = Slot{orderId, entry};
+        ++count;
+        return true;
+    }
+
+    bool erase(int64_t orderId) {
+        size_t i = home(orderId);
+        for (; table[i].entry; i = (i + 1) & mask) {
+            if (table[i].orderId == orderId)
+                break;
+        }
+        if (!table[i].entry)
+            return false;
+
+        // Shift later members of the probe run back into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; table[j].entry; j = (j + 1) & mask) {
+            size_t want = home(table[j].orderId);
+            // Move j into the hole unless its home lies cyclically in (hole, j]
+            bool homeBetween = hole <= j ? (hole < want && want <= j) : (hole < want || want <= j);
+            if (!homeBetween) {
+                table[hole] = table[j];
+                hole = j;
+            }
+        }
+        table[hole] = Slot{0, nullptr};
+        --count;
+        return true;
+    }
+
+    // Calls fn(entry) for every indexed entry
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const Slot& slot : table) {
+            if (slot.entry)
+                fn(slot.entry);
+        }
+    }
+
+    size_t size() const { return count; }
+};
+
+#endif // ORDER_INDEX_H
@@ -0,0 +1,276 @@
+#include "Pipeline.h"
+#include "CpuAffinity.h"
+#include "Logger.h"
+#include "Stats.h"
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Spins while work keeps arriving and yields the CPU once a stage has been idle
+// for a while, so an oversubscribed host still makes progress
+class Backoff {
+private:
+    int idleSpins = 0;
+
+public:
+    void reset() { idleSpins = 0; }
+
+    void wait() {
+        if (++idleSpins < SPINS_BEFORE_YIELD) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+};
+
+} // namespace
+
+OrderPipeline::OrderPipeline(NetworkInterface& network, size_t slotCount)
+    : network(network), freeSlots(slotCount), received(slotCount), decoded(slotCount), completed(slotCount) {
+    // One slot per queue entry, so a push can never find its queue full
+    slots.resize(freeSlots.capacity());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        Slot& slot = slots[i];
+        slot.dataIov.iov_base = slot.data;
+        slot.dataIov.iov_len = NetworkInterface::MAX_DATAGRAM;
+        slot.responseIov.iov_base = slot.response;
+        slot.responseIov.iov_len = 0;
+        freeSlots.tryPush(static_cast<uint32_t>(i));
+    }
+}
+
+void OrderPipeline::push(Queue& queue, uint32_t index) {
+    slots[index].enqueuedAt = nowNs();
+    while (!queue.tryPush(index)) {
+        cpuRelax();  // Unreachable while every queue holds all slots; kept for safety
+    }
+}
+
+bool OrderPipeline::pop(Queue& queue, StageCounters& counters, uint32_t& index) {
+    if (!queue.tryPop(index)) {
+        return false;
+    }
+    uint64_t dwell = nowNs() - slots[index].enqueuedAt;
+    relaxedAdd(counters.messages, 1);
+    relaxedAdd(counters.dwellNs, dwell);
+    relaxedMax(counters.maxDwellNs, dwell);
+    relaxedMax(counters.maxDepth, queue.size() + 1);
+    return true;
+}
+
+void OrderPipeline::run(OrderHandler& engine) {
+    // Blocking receives wake up regularly so the receiver sees a shutdown handled by the parser
+    network.setReceiveTimeout(100);
+
+    std::thread parser([this]() {
+        placeStage(0, "parser");
+        parse();
+    });
+    std::thread matcher([this, &engine]() {
+        placeStage(1, "matcher");
+        match(engine);
+    });
+    std::thread responder([this]() {
+        placeStage(2, "responder");
+        respond();
+    });
+
+    receive();
+
+    parser.join();
+    matcher.join();
+    responder.join();
+
+    Logger::getInstance().log("Server has stopped.");
+}
+
+void OrderPipeline::placeStage(size_t stage, const char* name) const {
+    int core = stage < stageCores.size() ? stageCores[stage] : -1;
+    if (core >= 0 || rtPriority > 0) {
+        Logger::getInstance().log(std::string("Pipeline ") + name + " " + placeCurrentThread(core, rtPriority));
+    }
+}
+
+// Receiver: claims free slots and fills as many as one receive call returns
+void OrderPipeline::receive() {
+    const size_t batch = network.getBatchSize();
+    std::vector<mmsghdr> msgs(batch);
+    std::vector<uint32_t> held(batch);   // Claimed slots not yet filled
+    size_t heldCount = 0;
+    Backoff backoff;
+
+    while (network.running()) {
+        uint32_t index;
+        while (heldCount < batch && freeSlots.tryPop(index)) {
+            held[heldCount++] = index;
+        }
+        if (heldCount == 0) {
+            relaxedAdd(slotWaits, 1);  // Every slot is downstream; let the socket buffer absorb the burst
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+
+        for (size_t i = 0; i < heldCount; ++i) {
+            Slot& slot = slots[held[i]];
+            msgs[i].msg_hdr = msghdr{};
+            msgs[i].msg_hdr.msg_iov = &slot.dataIov;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &slot.client;
+        }
+
+        size_t count = static_cast<size_t>(network.receiveBatch(msgs.data(), heldCount));
+        uint64_t receivedAt = nowNs();
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots[held[i]];
+            slot.receivedAt = receivedAt;
+            slot.length = msgs[i].msg_len;
+            slot.clientLength = msgs[i].msg_hdr.msg_namelen;
+            push(received, held[i]);
+        }
+
+        // Keep the unfilled slots for the next call
+        for (size_t i = count; i < heldCount; ++i) {
+            held[i - count] = held[i];
+        }
+        heldCount -= count;
+    }
+
+    receiverDone.store(true, std::memory_order_release);
+}
+
+// Parser: decodes and validates; control commands and malformed requests get
+// their reply here and pass through the matcher untouched
+void OrderPipeline::parse() {
+    Backoff backoff;
+    uint32_t index;
+
+    while (true) {
+        bool upstreamDone = receiverDone.load(std::memory_order_acquire);
+        if (pop(received, parseCounters, index)) {
+            Slot& slot = slots[index];
+            slot.responseLength = 0;
+            slot.forEngine = network.decodeDatagram(slot.data, slot.length, slot.message,
+                                                    slot.response, slot.responseLength);
+            push(decoded, index);
+            backoff.reset();
+        } else if (upstreamDone) {
+            break;  // Checked before the pop, so the queue is drained for good
+        } else {
+            backoff.wait();
+        }
+    }
+
+    parserDone.store(true, std::memory_order_release);
+}
+
+// Matcher: the only thread that touches the engine. It takes whatever the parser
+// has ready, up to one batch, and commits the engine before passing the batch on,
+// so no reply leaves ahead of its request's journal record.
+void OrderPipeline::match(OrderHandler& engine) {
+    const size_t batch = network.getBatchSize();
+    std::vector<uint32_t> taken(batch);
+    Backoff backoff;
+
+    while (true) {
+        bool upstreamDone = parserDone.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (count < batch && pop(decoded, matchCounters, taken[count])) {
+            Slot& slot = slots[taken[count]];
+            if (slot.forEngine) {
+                slot.responseLength = network.executeMessage(slot.message, slot.data, slot.length,
+                                                             engine, slot.response);
+            }
+            ++count;
+        }
+        if (count == 0) {
+            if (upstreamDone) {
+                break;
+            }
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+
+        engine.commit();
+        for (size_t i = 0; i < count; ++i) {
+            push(completed, taken[i]);
+        }
+    }
+
+    matcherDone.store(true, std::memory_order_release);
+}
+
+// Responder: sends whatever replies are ready in one call and recycles the slots
+void OrderPipeline::respond() {
+    const size_t batch = network.getBatchSize();
+    std::vector<mmsghdr> msgs(batch);
+    std::vector<uint32_t> taken(batch);
+    Backoff backoff;
+
+    while (true) {
+        bool upstreamDone = matcherDone.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (count < batch && pop(completed, respondCounters, taken[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            if (upstreamDone) {
+                break;
+            }
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+
+        size_t replies = 0;
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots[taken[i]];
+            if (slot.responseLength == 0) {
+                continue;
+            }
+            slot.responseIov.iov_len = slot.responseLength;
+            msgs[replies].msg_hdr = msghdr{};
+            msgs[replies].msg_hdr.msg_iov = &slot.responseIov;
+            msgs[replies].msg_hdr.msg_iovlen = 1;
+            msgs[replies].msg_hdr.msg_name = &slot.client;
+            msgs[replies].msg_hdr.msg_namelen = slot.clientLength;
+            ++replies;
+        }
+        if (replies) {
+            network.sendBatch(msgs.data(), replies);
+            for (size_t i = 0; i < count; ++i) {
+                const Slot& slot = slots[taken[i]];
+                if (slot.responseLength != 0) {
+                    network.recordReply(slot.receivedAt);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            push(freeSlots, taken[i]);
+        }
+    }
+}
+
+std::string OrderPipeline::report() const {
+    std::ostringstream oss;
+    auto stage = [&](const char* name, const Queue& queue, const StageCounters& counters) {
+        uint64_t messages = counters.messages.load(std::memory_order_relaxed);
+        uint64_t dwell = counters.dwellNs.load(std::memory_order_relaxed);
+        oss << name << ": messages=" << messages
+            << " depth=" << queue.size()
+            << " maxDepth=" << counters.maxDepth.load(std::memory_order_relaxed)
+            << " meanDwellNs=" << (messages ? dwell / messages : 0)
+            << " maxDwellNs=" << counters.maxDwellNs.load(std::memory_order_relaxed) << "\n";
+    };
+
+    oss << "receive: freeSlots=" << freeSlots.size() << "/" << slots.size()
+        << " slotWaits=" << slotWaits.load(std::memory_order_relaxed) << "\n";
+    stage("parse", received, parseCounters);
+    stage("match", decoded, matchCounters);
+    stage("respond", completed, respondCounters);
+    return oss.str();
+}
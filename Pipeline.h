@@ -0,0 +1,104 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "NetworkInterface.h"
+#include "Message.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Queue statistics for one pipeline stage. Each field is written only by the
+// thread named in its comment, so plain relaxed stores suffice.
+struct StageCounters {
+    std::atomic<uint64_t> messages{0};    // Slots taken off the stage's queue (consumer)
+    std::atomic<uint64_t> dwellNs{0};     // Total time those slots waited in the queue (consumer)
+    std::atomic<uint64_t> maxDwellNs{0};  // Longest single wait (consumer)
+    std::atomic<uint64_t> maxDepth{0};    // Deepest queue seen when popping (consumer)
+};
+
+// Runs the network front end as four threads instead of one:
+//
+//   receiver -> parser -> matcher -> responder
+//
+// The receiver fills preallocated slots with datagrams (recvmmsg), the parser
+// decodes and validates them, the matcher hands them to the engine, and the
+// responder sends the replies (sendmmsg) and returns the slots to the receiver.
+// Consecutive stages are joined by SpscRings of slot indices, so nothing is
+// copied or allocated between stages. When every slot is in flight the receiver
+// waits and datagrams queue in the kernel socket buffer.
+class OrderPipeline {
+private:
+    struct Slot {
+        char data[NetworkInterface::MAX_DATAGRAM + 1];  // Datagram plus a terminator
+        char response[NetworkInterface::MAX_RESPONSE];
+        sockaddr_in client;
+        socklen_t clientLength;
+        iovec dataIov;
+        iovec responseIov;
+        OrderMessage message;
+        size_t length;          // Bytes received
+        size_t responseLength;  // 0: nothing to send
+        bool forEngine;         // Decoded and waiting for the matcher
+        uint64_t enqueuedAt;    // Nanoseconds, stamped when pushed onto the next queue
+        uint64_t receivedAt;    // Nanoseconds, stamped when the datagram was received
+    };
+
+    using Queue = SpscRing<uint32_t>;
+
+    NetworkInterface& network;
+    std::vector<Slot> slots;
+    Queue freeSlots;   // responder -> receiver
+    Queue received;    // receiver -> parser
+    Queue decoded;     // parser -> matcher
+    Queue completed;   // matcher -> responder
+
+    StageCounters parseCounters;
+    StageCounters matchCounters;
+    StageCounters respondCounters;
+    std::atomic<uint64_t> slotWaits{0};   // Receiver passes that found no free slot (receiver)
+
+    // Set by each stage when it has pushed its last slot
+    std::atomic<bool> receiverDone{false};
+    std::atomic<bool> parserDone{false};
+    std::atomic<bool> matcherDone{false};
+
+    std::vector<int> stageCores;  // Parser, matcher, responder; -1 or missing for unpinned
+    int rtPriority = 0;           // SCHED_FIFO priority of the stage threads, 0 for none
+
+    // Applies the placement of stage `stage` (an index into stageCores) to the calling thread
+    void placeStage(size_t stage, const char* name) const;
+
+    void push(Queue& queue, uint32_t index);
+    bool pop(Queue& queue, StageCounters& counters, uint32_t& index);
+
+    void receive();
+    void parse();
+    void match(OrderHandler& engine);
+    void respond();
+
+public:
+    // `slotCount` bounds the requests in flight across all stages
+    OrderPipeline(NetworkInterface& network, size_t slotCount = 4096);
+
+    OrderPipeline(const OrderPipeline&) = delete;
+    OrderPipeline& operator=(const OrderPipeline&) = delete;
+
+    // Where the parser, matcher and responder threads run. The receiver is the
+    // thread that calls run(), placed by the caller. Call before run().
+    void setPlacement(const std::vector<int>& cores, int priority) {
+        stageCores = cores;
+        rtPriority = priority;
+    }
+
+    // Runs all four stages until a shutdown request, then lets every slot in
+    // flight finish before returning. Call once. Register report() with
+    // NetworkInterface::addStatsSource to include it in "stats" replies.
+    void run(OrderHandler& engine);
+
+    // One line per stage: messages, current and peak depth, mean and peak dwell time
+    std::string report() const;
+};
+
+#endif // PIPELINE_H
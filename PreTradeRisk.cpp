@@ -0,0 +1,36 @@
+#include "PreTradeRisk.h"
+#include <sstream>
+
+PreTradeRisk::PreTradeRisk(const RiskLimits& limits, size_t symbolCount, const std::vector<double>& tickSizes,
+                           bool checkRate)
+    : limits(limits),
+      symbolCount(symbolCount),
+      exposures(limits.traderCount() * symbolCount),
+      activity(limits.traderCount()),
+      lastTrade(symbolCount, 0),
+      tickSizes(symbolCount, 1.0),
+      rateChecked(checkRate) {
+    for (size_t symbolId = 0; symbolId < symbolCount && symbolId < tickSizes.size(); ++symbolId) {
+        this->tickSizes[symbolId] = tickSizes[symbolId];
+    }
+}
+
+void PreTradeRisk::reject(Check check, const Order& order, const std::string& detail) {
+    relaxedAdd(rejects[check], 1);
+    throw RiskRejection("Risk check failed for order " + std::to_string(order.orderId) + " of trader " +
+                        std::to_string(order.traderId) + ": " + detail);
+}
+
+std::string PreTradeRisk::report() const {
+    static const char* const names[CHECKS] = {"trader", "quantity", "notional", "position", "rate", "band"};
+    uint64_t total = 0;
+    std::ostringstream checks;
+    for (int check = 0; check < CHECKS; ++check) {
+        uint64_t count = rejects[check].load(std::memory_order_relaxed);
+        total += count;
+        checks << " " << names[check] << "=" << count;
+    }
+    std::ostringstream oss;
+    oss << "risk: rejects=" << total << checks.str() << (rateChecked ? "" : " rateCheck=off") << "\n";
+    return oss.str();
+}
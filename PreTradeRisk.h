@@ -0,0 +1,135 @@
+#ifndef PRE_TRADE_RISK_H
+#define PRE_TRADE_RISK_H
+
+#include "RiskLimits.h"
+#include "Execution.h"
+#include "Order.h"
+#include "Stats.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pre-trade checks of one MatchingEngine against the limits in force, and the
+// per-trader state they need, kept up to date by the engine as orders rest,
+// leave the book and fill. Everything is in flat arrays sized up front and
+// indexed by trader and symbol ID, so a check is a handful of loads and compares;
+// only the engine's thread touches it.
+class PreTradeRisk {
+public:
+    enum Check { Trader, Quantity, Notional, Position, Rate, Band, CHECKS };
+
+private:
+    struct Exposure {
+        int64_t position = 0;     // Filled quantity, bought minus sold
+        int64_t workingBuy = 0;   // Resting buy quantity
+        int64_t workingSell = 0;  // Resting sell quantity
+    };
+
+    struct Activity {
+        uint64_t windowStart = 0;  // Start of the current one-second window
+        uint32_t orders = 0;       // Orders accepted in it
+    };
+
+    const RiskLimits& limits;
+    size_t symbolCount;
+    std::vector<Exposure> exposures;  // Trader ID * symbolCount + symbol ID
+    std::vector<Activity> activity;   // By trader ID
+    std::vector<int64_t> lastTrade;   // By symbol ID, ticks; 0 until the first trade
+    std::vector<double> tickSizes;    // By symbol ID
+    bool rateChecked;                 // Off where time is not the wall clock's, as in replay
+    std::atomic<uint64_t> rejects[CHECKS] = {};
+
+    Exposure* exposureOf(int traderId, uint32_t symbolId) {
+        size_t trader = static_cast<size_t>(static_cast<unsigned>(traderId));
+        return trader < activity.size() ? &exposures[trader * symbolCount + symbolId] : nullptr;
+    }
+
+    // Counts the rejection and throws RiskRejection
+    [[noreturn]] void reject(Check check, const Order& order, const std::string& detail);
+
+public:
+    // `tickSizes` gives each symbol ID's tick in instrument units; symbols past
+    // its end count one unit per tick. Without `checkRate` the max-rate limit is ignored.
+    PreTradeRisk(const RiskLimits& limits, size_t symbolCount, const std::vector<double>& tickSizes,
+                 bool checkRate = true);
+
+    // Throws RiskRejection if `order` breaks a limit of its trader. `reference` is
+    // the price a market order is valued at (the opposing touch), 0 if none;
+    // `now` is nowNs(). An order that passes counts towards the trader's rate.
+    void check(const Order& order, int64_t reference, uint64_t now) {
+        Exposure* exposure = exposureOf(order.traderId, order.symbolId);
+        if (!exposure) {
+            reject(Trader, order, "trader ID outside the risk table");
+        }
+        const TraderLimits& traderLimits = limits.table().of(static_cast<size_t>(order.traderId));
+
+        if (traderLimits.maxOrderQuantity && order.quantity > traderLimits.maxOrderQuantity) {
+            reject(Quantity, order, "quantity over " + std::to_string(traderLimits.maxOrderQuantity));
+        }
+
+        int64_t last = lastTrade[order.symbolId];
+        int64_t price = order.isMarketOrder ? (reference ? reference : last) : order.price;
+        if (traderLimits.maxNotional && price &&
+            static_cast<double>(price) * tickSizes[order.symbolId] * order.quantity > traderLimits.maxNotional) {
+            reject(Notional, order, "notional over " + std::to_string(traderLimits.maxNotional));
+        }
+
+        if (traderLimits.maxPosition) {
+            int64_t worst = order.side == 'B' ? exposure->position + exposure->workingBuy + order.quantity
+                                              : exposure->workingSell + order.quantity - exposure->position;
+            if (worst > traderLimits.maxPosition) {
+                reject(Position, order, "position could reach " + std::to_string(worst) + ", limit " +
+                                            std::to_string(traderLimits.maxPosition));
+            }
+        }
+
+        if (traderLimits.priceBandBps && last && !order.isMarketOrder) {
+            int64_t distance = order.price > last ? order.price - last : last - order.price;
+            if (distance * 10000 > static_cast<int64_t>(traderLimits.priceBandBps) * last) {
+                reject(Band, order, "price more than " + std::to_string(traderLimits.priceBandBps) +
+                                        " bps from the last trade, " + std::to_string(last) + " ticks");
+            }
+        }
+
+        Activity& trader = activity[static_cast<size_t>(order.traderId)];
+        if (now - trader.windowStart >= 1000000000ULL) {
+            trader.windowStart = now;
+            trader.orders = 0;
+        }
+        if (rateChecked && traderLimits.maxOrdersPerSecond && trader.orders >= traderLimits.maxOrdersPerSecond) {
+            reject(Rate, order, "over " + std::to_string(traderLimits.maxOrdersPerSecond) + " orders per second");
+        }
+        ++trader.orders;
+    }
+
+    // Quantity of a trader's order went onto the book
+    void rested(int traderId, uint32_t symbolId, char side, int quantity) {
+        if (Exposure* exposure = exposureOf(traderId, symbolId)) {
+            (side == 'B' ? exposure->workingBuy : exposure->workingSell) += quantity;
+        }
+    }
+
+    // Quantity of a trader's resting order left the book without trading
+    void removed(int traderId, uint32_t symbolId, char side, int quantity) {
+        rested(traderId, symbolId, side, -quantity);
+    }
+
+    // A fill of `taker`; the fill must carry the maker's trader ID
+    void filled(const Order& taker, const Fill& fill) {
+        int64_t signedQuantity = taker.side == 'B' ? fill.quantity : -static_cast<int64_t>(fill.quantity);
+        if (Exposure* exposure = exposureOf(taker.traderId, taker.symbolId)) {
+            exposure->position += signedQuantity;
+        }
+        if (Exposure* exposure = exposureOf(fill.makerTraderId, taker.symbolId)) {
+            exposure->position -= signedQuantity;
+            (taker.side == 'B' ? exposure->workingSell : exposure->workingBuy) -= fill.quantity;
+        }
+        lastTrade[taker.symbolId] = fill.price;
+    }
+
+    // "risk:" line with rejections by check, noting a rate check that is off
+    std::string report() const;
+};
+
+#endif // PRE_TRADE_RISK_H
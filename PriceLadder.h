@@ -0,0 +1,294 @@
+#ifndef PRICE_LADDER_H
+#define PRICE_LADDER_H
+
+#include "AVLTree.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Price range one side of a book keeps in a dense array
+struct LadderConfig {
+    int64_t lowestPrice = 0;   // Ticks; price of the first slot
+    size_t width = 0;          // Slots, one per tick; 0 keeps every level in the tree
+};
+
+// One bit per slot with two summary levels above it (a bit per non-empty word of
+// the level below), so the first or last set bit from any position is found with
+// at most three count-trailing/leading-zeros steps.
+class LevelBitmap {
+private:
+    std::vector<uint64_t> leaves;   // Bit per slot
+    std::vector<uint64_t> summary;  // Bit per non-empty leaf word
+    uint64_t top;                   // Bit per non-empty summary word
+    size_t slots;
+
+    static size_t lowestBit(uint64_t bits) { return static_cast<size_t>(__builtin_ctzll(bits)); }
+    static size_t highestBit(uint64_t bits) { return 63 - static_cast<size_t>(__builtin_clzll(bits)); }
+    static uint64_t bitsFrom(size_t bit) { return ~0ull << bit; }        // Bits `bit` and above
+    static uint64_t bitsUpTo(size_t bit) { return ~0ull >> (63 - bit); } // Bits `bit` and below
+
+    size_t firstInLeaf(size_t leaf) const { return leaf << 6 | lowestBit(leaves[leaf]); }
+    size_t lastInLeaf(size_t leaf) const { return leaf << 6 | highestBit(leaves[leaf]); }
+
+public:
+    static constexpr size_t NONE = ~size_t{0};
+    static constexpr size_t MAX_SLOTS = 64 * 64 * 64;
+
+    explicit LevelBitmap(size_t slots)
+        : leaves((slots + 63) / 64), summary((slots + 4095) / 4096), top(0), slots(slots) {
+        if (slots > MAX_SLOTS) {
+            throw std::invalid_argument("Price ladder is limited to " + std::to_string(MAX_SLOTS) + " ticks");
+        }
+    }
+
+    void set(size_t slot) {
+        size_t leaf = slot >> 6;
+        leaves[leaf] |= 1ull << (slot & 63);
+        summary[leaf >> 6] |= 1ull << (leaf & 63);
+        top |= 1ull << (leaf >> 6);
+    }
+
+    void clear(size_t slot) {
+        size_t leaf = slot >> 6;
+        leaves[leaf] &= ~(1ull << (slot & 63));
+        if (leaves[leaf] == 0) {
+            summary[leaf >> 6] &= ~(1ull << (leaf & 63));
+            if (summary[leaf >> 6] == 0) {
+                top &= ~(1ull << (leaf >> 6));
+            }
+        }
+    }
+
+    // Lowest set slot at or above `from`, or NONE
+    size_t next(size_t from) const {
+        size_t leaf = from >> 6;
+        if (from >= slots) {
+            return NONE;
+        }
+        if (uint64_t bits = leaves[leaf] & bitsFrom(from & 63)) {
+            return leaf << 6 | lowestBit(bits);
+        }
+        size_t after = leaf + 1;  // First leaf word still to search
+        size_t word = after >> 6;
+        if (word < summary.size()) {
+            if (uint64_t bits = summary[word] & bitsFrom(after & 63)) {
+                return firstInLeaf(word << 6 | lowestBit(bits));
+            }
+        }
+        if (word + 1 < 64) {
+            if (uint64_t bits = top & bitsFrom(word + 1)) {
+                size_t next = lowestBit(bits);
+                return firstInLeaf(next << 6 | lowestBit(summary[next]));
+            }
+        }
+        return NONE;
+    }
+
+    // Highest set slot at or below `from`, or NONE
+    size_t prev(size_t from) const {
+        if (slots == 0) {
+            return NONE;
+        }
+        if (from >= slots) {
+            from = slots - 1;
+        }
+        size_t leaf = from >> 6;
+        if (uint64_t bits = leaves[leaf] & bitsUpTo(from & 63)) {
+            return leaf << 6 | highestBit(bits);
+        }
+        if (leaf == 0) {
+            return NONE;
+        }
+        size_t before = leaf - 1;  // Last leaf word still to search
+        size_t word = before >> 6;
+        if (uint64_t bits = summary[word] & bitsUpTo(before & 63)) {
+            return lastInLeaf(word << 6 | highestBit(bits));
+        }
+        if (word == 0) {
+            return NONE;
+        }
+        if (uint64_t bits = top & bitsUpTo(word - 1)) {
+            size_t prev = highestBit(bits);
+            return lastInLeaf(prev << 6 | highestBit(summary[prev]));
+        }
+        return NONE;
+    }
+
+    // Calls fn(slot) for every set slot, lowest first or highest first if
+    // `descending`, until fn returns false. Each word is consumed bit by bit and
+    // the summaries are only consulted to skip to the next non-empty word.
+    template <typename Fn>
+    bool forEachSet(bool descending, Fn&& fn) const {
+        if (!descending) {
+            for (size_t slot = next(0); slot != NONE; slot = next((slot | 63) + 1)) {
+                for (uint64_t bits = leaves[slot >> 6] & bitsFrom(slot & 63); bits; bits &= bits - 1) {
+                    if (!fn((slot & ~size_t{63}) | lowestBit(bits))) return false;
+                }
+            }
+        } else {
+            for (size_t slot = prev(slots); slot != NONE; slot = slot < 64 ? NONE : prev((slot & ~size_t{63}) - 1)) {
+                for (uint64_t bits = leaves[slot >> 6] & bitsUpTo(slot & 63); bits;
+                     bits &= ~(1ull << highestBit(bits))) {
+                    if (!fn((slot & ~size_t{63}) | highestBit(bits))) return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// The price levels of one side of a book, with the same interface as AVLTree.
+// Levels within LadderConfig's range sit in a slot array indexed by tick offset,
+// so finding a level is one index and the next occupied one a bitmap scan;
+// levels outside it fall back to an AVLTree. With a width of 0 this is just the
+// tree. Levels come from the shared pool either way, so their addresses are
+// stable and capacity is accounted in one place.
+class PriceLadder {
+public:
+    using Node = AVLTree::Node;
+    using OrderEntry = AVLTree::OrderEntry;
+
+private:
+    AVLTree::NodePool& pool;
+    AVLTree outside;            // Levels outside the array's range
+    int64_t lowestPrice;
+    size_t width;
+    std::vector<Node*> slots;   // Level at lowestPrice + i, or nullptr
+    LevelBitmap occupied;       // Non-null slots
+    Node* lowest;               // Cached lowest level (best ask on the sell side)
+    Node* highest;              // Cached highest level (best bid on the buy side)
+
+    // Wraps for prices below the range, so one compare checks both bounds
+    size_t slotOf(int64_t price) const {
+        return static_cast<size_t>(static_cast<uint64_t>(price) - static_cast<uint64_t>(lowestPrice));
+    }
+    bool inRange(int64_t price) const { return slotOf(price) < width; }
+
+    Node* lowestOf() const {
+        size_t slot = occupied.next(0);
+        Node* tree = outside.lowestLevel();
+        if (slot == LevelBitmap::NONE) return tree;
+        return tree && tree->price < lowestPrice ? tree : slots[slot];
+    }
+
+    Node* highestOf() const {
+        size_t slot = occupied.prev(width);
+        Node* tree = outside.highestLevel();
+        if (slot == LevelBitmap::NONE) return tree;
+        return tree && tree->price > lowestPrice ? tree : slots[slot];
+    }
+
+    // In price order, highest first if `descending`: tree levels on the near side
+    // of the range, the slots, then tree levels on the far side. Stops when fn
+    // returns false.
+    template <typename Fn>
+    void walk(bool descending, Fn& fn) const {
+        if (width == 0) {
+            outside.forEachLevelWhile(descending, fn);
+            return;
+        }
+
+        bool going = true;
+        auto nearSide = [&](const Node& node) {
+            if (descending ? node.price < lowestPrice : node.price > lowestPrice) return false;
+            return going = fn(node);
+        };
+        outside.forEachLevelWhile(descending, nearSide);
+        if (!going) return;
+
+        if (!occupied.forEachSet(descending, [&](size_t slot) { return fn(*slots[slot]); })) return;
+
+        auto farSide = [&](const Node& node) {
+            if (descending ? node.price > lowestPrice : node.price < lowestPrice) return true;
+            return going = fn(node);
+        };
+        outside.forEachLevelWhile(descending, farSide);
+    }
+
+public:
+    explicit PriceLadder(AVLTree::NodePool& pool, const LadderConfig& config = LadderConfig())
+        : pool(pool), outside(pool), lowestPrice(config.lowestPrice), width(config.width),
+          slots(config.width, nullptr), occupied(config.width), lowest(nullptr), highest(nullptr) {}
+
+    // Returns the slot levels to the pool; the tree returns its own
+    ~PriceLadder() {
+        for (Node* level : slots) {
+            if (level) pool.destroy(level);
+        }
+    }
+
+    PriceLadder(const PriceLadder&) = delete;
+    PriceLadder& operator=(const PriceLadder&) = delete;
+
+    // Appends the entry to the queue at `price`, creating the level if needed
+    Node* insert(int64_t price, OrderEntry* entry) {
+        Node* level;
+        if (inRange(price)) {
+            size_t slot = slotOf(price);
+            level = slots[slot];
+            if (!level) {
+                level = slots[slot] = pool.create(price);
+                occupied.set(slot);
+            }
+            level->append(entry);
+        } else {
+            level = outside.insert(price, entry);
+        }
+
+        if (!lowest || price < lowest->price)
+            lowest = level;
+        if (!highest || price > highest->price)
+            highest = level;
+        return level;
+    }
+
+    // Removes the whole price level; its queue must already be empty
+    void remove(int64_t price) {
+        bool wasLowest = lowest && lowest->price == price;
+        bool wasHighest = highest && highest->price == price;
+
+        if (inRange(price)) {
+            size_t slot = slotOf(price);
+            if (slots[slot]) {
+                pool.destroy(slots[slot]);
+                slots[slot] = nullptr;
+                occupied.clear(slot);
+            }
+        } else {
+            outside.remove(price);
+        }
+
+        if (wasLowest)
+            lowest = lowestOf();
+        if (wasHighest)
+            highest = highestOf();
+    }
+
+    Node* find(int64_t price) const {
+        return inRange(price) ? slots[slotOf(price)] : outside.find(price);
+    }
+
+    // Calls fn(const Node&) for every level in price order, highest first if `descending`
+    template <typename Fn>
+    void forEachLevel(bool descending, Fn fn) const {
+        auto always = [&fn](const Node& node) {
+            fn(node);
+            return true;
+        };
+        walk(descending, always);
+    }
+
+    // Like forEachLevel, but stops at the first level for which fn(const Node&) returns false
+    template <typename Fn>
+    void forEachLevelWhile(bool descending, Fn fn) const {
+        walk(descending, fn);
+    }
+
+    Node* lowestLevel() const { return lowest; }
+    Node* highestLevel() const { return highest; }
+    bool empty() const { return !lowest; }
+};
+
+#endif // PRICE_LADDER_H
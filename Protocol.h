@@ -0,0 +1,131 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary order-entry protocol. Every request datagram is one fixed-size, packed,
+// little-endian message starting with WireHeader. Prices are integer ticks.
+// A reply is a WireAck followed by WireAck::fillCount WireFill records.
+//
+// The first byte of PROTOCOL_MAGIC is not printable ASCII, so a listener can
+// tell binary datagrams from the text format by their first two bytes.
+//
+// Over TCP (see TcpGateway.h) every message in either direction, binary or text,
+// is preceded by a TcpFrameHeader. Besides replies, the gateway sends a session
+// unsolicited WireExecution messages when its resting orders trade.
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "The wire protocol is decoded in place and assumes a little-endian host");
+
+constexpr uint16_t PROTOCOL_MAGIC = 0x4FA5;   // Bytes A5 4F on the wire
+constexpr uint8_t PROTOCOL_VERSION = 4;       // 2: symbolId added to the header, 3: fills in the ack,
+                                              // 4: 64-bit order IDs
+
+enum class WireType : uint8_t {
+    NewOrder = 1,
+    Cancel = 2,
+    Replace = 3,
+    Ack = 4,        // Engine to client
+    Execution = 5   // Engine to TCP client: a resting order traded
+};
+
+#pragma pack(push, 1)
+
+struct WireHeader {
+    uint16_t magic;     // PROTOCOL_MAGIC
+    uint8_t version;    // PROTOCOL_VERSION
+    uint8_t type;       // WireType
+    uint32_t symbolId;  // Instrument, as listed in the engine's symbol file
+    uint64_t sequence;  // Client-assigned, echoed back in the response
+};
+
+struct WireNewOrder {
+    WireHeader header;
+    int64_t orderId;
+    int64_t price;      // Ticks
+    int64_t timestamp;
+    int32_t quantity;
+    int32_t traderId;
+    char side;          // 'B' or 'S'
+    uint8_t isMarketOrder;
+    uint8_t timeInForce;  // TimeInForce: 0 day, 1 IOC, 2 FOK
+    uint8_t reserved;
+};
+
+struct WireCancel {
+    WireHeader header;
+    int64_t orderId;
+};
+
+struct WireReplace {
+    WireHeader header;
+    int64_t orderId;
+    int64_t price;      // Ticks
+    int32_t quantity;   // New open quantity
+};
+
+struct WireAck {
+    WireHeader header;  // Sequence of the request being acknowledged
+    int64_t orderId;
+    int32_t openQuantity; // Left resting on the book after the request
+    uint16_t fillCount;   // WireFill records following this ack
+    uint8_t accepted;     // 1 if processed, 0 if rejected
+    uint8_t flags;        // ACK_QUEUED, ACK_TRUNCATED, ACK_CANCELLED
+};
+
+constexpr uint8_t ACK_QUEUED = 1;     // Queued for a matching thread; fills and open quantity not reported
+constexpr uint8_t ACK_TRUNCATED = 2;  // More fills happened than fit in the datagram
+constexpr uint8_t ACK_CANCELLED = 4;  // What did not fill was cancelled (market, IOC or FOK order, or no room to rest)
+
+// One execution of the acknowledged (taker) order
+struct WireFill {
+    int64_t makerId;
+    int64_t price;          // Ticks
+    int32_t quantity;
+    int32_t takerRemaining; // Taker quantity still open after this fill
+    int32_t makerRemaining; // Maker quantity still resting after this fill
+};
+
+// One execution of an order that was not the request being acknowledged: a
+// session's resting order hit by someone else, or any trade on a drop copy
+struct WireExecution {
+    WireHeader header;      // Sequence is 0
+    int64_t orderId;
+    int64_t contraId;       // The other order in the trade
+    int64_t price;          // Ticks
+    int32_t quantity;
+    int32_t remaining;      // Quantity of orderId still open after this fill
+    char side;              // Side of orderId
+    uint8_t reserved[3];
+};
+
+// Precedes every message on a TCP session
+struct TcpFrameHeader {
+    uint32_t length;    // Message bytes following this header
+    uint32_t sequence;  // Per session and direction: 1 for the first frame, then gap-free
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(WireHeader) == 16, "WireHeader layout changed");
+static_assert(sizeof(WireNewOrder) == 52, "WireNewOrder layout changed");
+static_assert(sizeof(WireCancel) == 24, "WireCancel layout changed");
+static_assert(sizeof(WireReplace) == 36, "WireReplace layout changed");
+static_assert(sizeof(WireAck) == 32, "WireAck layout changed");
+static_assert(sizeof(WireFill) == 28, "WireFill layout changed");
+static_assert(sizeof(WireExecution) == 52, "WireExecution layout changed");
+static_assert(sizeof(TcpFrameHeader) == 8, "TcpFrameHeader layout changed");
+
+// Length of a client request of this WireType, 0 if it is not one. Splits a
+// file of back-to-back requests, which carry no framing of their own.
+inline size_t wireRequestSize(uint8_t type) {
+    switch (static_cast<WireType>(type)) {
+        case WireType::NewOrder: return sizeof(WireNewOrder);
+        case WireType::Cancel: return sizeof(WireCancel);
+        case WireType::Replace: return sizeof(WireReplace);
+        default: return 0;
+    }
+}
+
+#endif // PROTOCOL_H
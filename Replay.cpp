@@ -0,0 +1,152 @@
+#include "Replay.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// FNV-1a, folded in one field at a time
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+
+void digest(uint64_t& hash, uint64_t value) {
+    for (int byte = 0; byte < 8; ++byte) {
+        hash ^= (value >> (byte * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+}
+
+} // namespace
+
+FileReplay::FileReplay(const std::string& path) : path(path), fillDigest(FNV_OFFSET), bookDigest(FNV_OFFSET) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open replay file " + path + ": " + std::strerror(errno));
+    }
+    struct stat info{};
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read replay file " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map replay file " + path);
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+    }
+    ::close(fd);
+}
+
+FileReplay::~FileReplay() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+template <typename Handle>
+void FileReplay::decodeAll(NetworkInterface& decoder, Handle handle) {
+    if (binary) {
+        for (size_t offset = 0; offset < size;) {
+            size_t length = size - offset >= sizeof(WireHeader)
+                                ? wireRequestSize(reinterpret_cast<const WireHeader*>(data + offset)->type)
+                                : 0;
+            if (length == 0 || length > size - offset) {
+                throw std::runtime_error("Replay file " + path + " has no whole request at byte " +
+                                         std::to_string(offset));
+            }
+            try {
+                handle(decoder.decodeBinary(data + offset, length));
+            } catch (const std::exception&) {
+                ++malformed;
+            }
+            offset += length;
+        }
+        return;
+    }
+
+    std::string line;
+    for (size_t offset = 0; offset < size;) {
+        const char* end = static_cast<const char*>(std::memchr(data + offset, '\n', size - offset));
+        size_t next = end ? static_cast<size_t>(end - data) + 1 : size;
+        line.assign(data + offset, (end ? end - data : size) - offset);
+        offset = next;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        try {
+            handle(decoder.parseMessage(line));
+        } catch (const std::exception&) {
+            ++malformed;
+        }
+    }
+}
+
+void FileReplay::run(NetworkInterface& decoder, MatchingEngine& engine) {
+    Logger& logger = Logger::getInstance();
+    binary = decoder.isBinary(data, size);
+
+    const LogLevel level = logger.getLevel();
+    logger.setLevel(LogLevel::Off);
+    ExecutionReport report;
+    uint64_t start = nowNs();
+    try {
+        decodeAll(decoder, [&](const OrderMessage& message) {
+            ++requests;
+            uint64_t before = nowNs();
+            try {
+                engine.processMessage(message, report);
+            } catch (const std::exception&) {
+                ++rejected;
+            }
+            request.record(nowNs() - before);
+            for (const Fill& fill : report.fills) {
+                digest(fillDigest, static_cast<uint64_t>(fill.takerId));
+                digest(fillDigest, static_cast<uint64_t>(fill.makerId));
+                digest(fillDigest, static_cast<uint64_t>(fill.price));
+                digest(fillDigest, static_cast<uint64_t>(fill.quantity));
+                tradedQuantity += fill.quantity;
+            }
+            fills += report.fills.size();
+        });
+    } catch (...) {
+        logger.setLevel(level);
+        throw;
+    }
+    elapsedNs = nowNs() - start;
+    logger.setLevel(level);
+
+    engine.forEachOrder([this](const Order& order) {
+        digest(bookDigest, static_cast<uint64_t>(order.orderId));
+        digest(bookDigest, static_cast<uint64_t>(order.price));
+        digest(bookDigest, static_cast<uint64_t>(order.quantity));
+        digest(bookDigest, static_cast<uint64_t>(order.side) << 32 | order.symbolId);
+        ++restingOrders;
+    });
+}
+
+std::string FileReplay::report() const {
+    double seconds = elapsedNs / 1e9;
+    std::ostringstream oss;
+    oss << "Replayed " << path << " (" << (binary ? "binary" : "text") << ", " << size << " bytes)\n"
+        << "replay: requests=" << requests << " malformed=" << malformed << " rejected=" << rejected
+        << " fills=" << fills << " tradedQuantity=" << tradedQuantity << " resting=" << restingOrders
+        << " elapsedMs=" << elapsedNs / 1000000
+        << " requestsPerSec=" << static_cast<uint64_t>(seconds > 0 ? requests / seconds : 0) << "\n"
+        << request.summary("request") << "\n"
+        << std::hex << std::setfill('0') << "digest: fills=" << std::setw(16) << fillDigest
+        << " book=" << std::setw(16) << bookDigest << "\n";
+    return oss.str();
+}
@@ -0,0 +1,58 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "MatchingEngine.h"
+#include "NetworkInterface.h"
+#include "Stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Offline run of a captured request file through one MatchingEngine, with no
+// sockets and logging off: for sizing hardware, and for checking that a build
+// gives the same fills on recorded flow. The file is either text, one request
+// per line as sent over UDP (blank lines and "#" comments skipped), or binary,
+// back-to-back WireNewOrder, WireCancel and WireReplace messages; its first
+// bytes tell which. It is memory-mapped and decoded in place.
+class FileReplay {
+private:
+    std::string path;
+    const char* data = nullptr;
+    size_t size = 0;
+
+    LatencyHistogram request;        // processMessage alone, per request: matching, cancels, rejections
+    uint64_t requests = 0;           // Handed to the engine
+    uint64_t malformed = 0;          // Could not be decoded
+    uint64_t rejected = 0;           // Thrown back by the engine
+    uint64_t fills = 0;
+    uint64_t tradedQuantity = 0;
+    uint64_t fillDigest = 0;         // Over every fill, in order
+    uint64_t bookDigest = 0;         // Over every resting order once the file is done
+    uint64_t restingOrders = 0;
+    uint64_t elapsedNs = 0;          // Decoding and matching the whole file
+    bool binary = false;
+
+    // Decodes each request in order and calls handle(message); counts the ones
+    // that cannot be decoded. Throws std::runtime_error if a binary file is cut
+    // off or holds an unknown message type, as the rest cannot be split.
+    template <typename Handle>
+    void decodeAll(NetworkInterface& decoder, Handle handle);
+
+public:
+    // Maps `path` read-only. Throws std::runtime_error if it cannot.
+    explicit FileReplay(const std::string& path);
+    ~FileReplay();
+
+    FileReplay(const FileReplay&) = delete;
+    FileReplay& operator=(const FileReplay&) = delete;
+
+    // Runs every request through `engine`, decoded by `decoder` (which may have
+    // no socket), then digests the books
+    void run(NetworkInterface& decoder, MatchingEngine& engine);
+
+    // Throughput, latency percentiles, counters and the two digests. Builds that
+    // match identically print identical "digest:" lines.
+    std::string report() const;
+};
+
+#endif // REPLAY_H
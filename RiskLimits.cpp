@@ -0,0 +1,110 @@
+#include "RiskLimits.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Applies one "name=value" setting to `limits`
+void applyLimit(TraderLimits& limits, const std::string& setting) {
+    size_t equals = setting.find('=');
+    if (equals == std::string::npos) {
+        throw std::invalid_argument("expected <limit>=<value>, got " + setting);
+    }
+    const std::string name = setting.substr(0, equals);
+    const std::string value = setting.substr(equals + 1);
+    if (name == "max-qty") {
+        limits.maxOrderQuantity = std::stoll(value);
+    } else if (name == "max-notional") {
+        limits.maxNotional = std::stod(value);
+    } else if (name == "max-position") {
+        limits.maxPosition = std::stoll(value);
+    } else if (name == "max-rate") {
+        limits.maxOrdersPerSecond = static_cast<uint32_t>(std::stoul(value));
+    } else if (name == "band-bps") {
+        limits.priceBandBps = static_cast<uint32_t>(std::stoul(value));
+    } else {
+        throw std::invalid_argument("unknown limit " + name);
+    }
+}
+
+struct LimitLine {
+    size_t number;
+    std::string trader;                 // "default" or a trader ID
+    std::vector<std::string> settings;
+};
+
+} // namespace
+
+std::unique_ptr<RiskLimitTable> RiskLimitTable::load(const std::string& path, size_t maxTraders) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open risk limits file " + path);
+    }
+
+    std::vector<LimitLine> lines;
+    std::string text;
+    for (size_t number = 1; std::getline(file, text); ++number) {
+        std::istringstream ss(text.substr(0, text.find('#')));
+        LimitLine line{number, "", {}};
+        if (!(ss >> line.trader)) {
+            continue;
+        }
+        std::string setting;
+        while (ss >> setting) {
+            line.settings.push_back(setting);
+        }
+        lines.push_back(std::move(line));
+    }
+
+    auto fail = [&](const LimitLine& line, const std::string& why) {
+        return std::runtime_error(path + ":" + std::to_string(line.number) + ": " + why);
+    };
+
+    // The default line first, so trader lines can start from it wherever it is
+    TraderLimits defaults;
+    for (const LimitLine& line : lines) {
+        if (line.trader != "default") {
+            continue;
+        }
+        try {
+            for (const std::string& setting : line.settings) {
+                applyLimit(defaults, setting);
+            }
+        } catch (const std::exception& e) {
+            throw fail(line, e.what());
+        }
+    }
+
+    auto table = std::make_unique<RiskLimitTable>(maxTraders);
+    table->traders.assign(maxTraders, defaults);
+    for (const LimitLine& line : lines) {
+        if (line.trader == "default") {
+            continue;
+        }
+        try {
+            size_t consumed = 0;
+            long long traderId = std::stoll(line.trader, &consumed);
+            if (consumed != line.trader.size() || traderId < 0 || static_cast<size_t>(traderId) >= maxTraders) {
+                throw std::invalid_argument("trader ID must be from 0 to " + std::to_string(maxTraders - 1));
+            }
+            for (const std::string& setting : line.settings) {
+                applyLimit(table->traders[traderId], setting);
+            }
+        } catch (const std::exception& e) {
+            throw fail(line, e.what());
+        }
+    }
+    return table;
+}
+
+RiskLimits::RiskLimits(const std::string& path, size_t maxTraders) : path(path), maxTraders(maxTraders) {
+    if (maxTraders == 0) {
+        throw std::invalid_argument("The risk table needs room for at least one trader");
+    }
+    reload();
+}
+
+void RiskLimits::reload() {
+    tables.push_back(RiskLimitTable::load(path, maxTraders));
+    current.store(tables.back().get(), std::memory_order_release);
+}
@@ -0,0 +1,78 @@
+#ifndef RISK_LIMITS_H
+#define RISK_LIMITS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Thrown for a request that fails a pre-trade risk check. Replay skips the checks;
+// a journaling front end marks every rejected request, so replay skips these too.
+class RiskRejection : public std::invalid_argument {
+public:
+    using std::invalid_argument::invalid_argument;
+};
+
+// Limits of one trader. 0 leaves that limit off.
+struct TraderLimits {
+    int64_t maxOrderQuantity = 0;    // Per order
+    double maxNotional = 0;          // Per order: price in instrument units times quantity
+    int64_t maxPosition = 0;         // Per symbol: filled position plus working orders on the order's side
+    uint32_t maxOrdersPerSecond = 0; // New orders and re-entering replaces
+    uint32_t priceBandBps = 0;       // Limit price within this many basis points of the symbol's last trade
+};
+
+// Limits of every trader, indexed by trader ID. Immutable once published.
+class RiskLimitTable {
+private:
+    std::vector<TraderLimits> traders;
+
+public:
+    explicit RiskLimitTable(size_t maxTraders) : traders(maxTraders) {}
+
+    // Reads a limits file:
+    //
+    //   # comment
+    //   default max-qty=1000 max-notional=250000 max-position=5000 max-rate=500 band-bps=300
+    //   2001 max-qty=100 max-rate=50
+    //
+    // Each trader line starts from the default line, wherever that appears, and
+    // overrides the limits it names. Traders not listed get the defaults.
+    // Throws std::runtime_error naming the line for anything it does not understand.
+    static std::unique_ptr<RiskLimitTable> load(const std::string& path, size_t maxTraders);
+
+    size_t size() const { return traders.size(); }
+    const TraderLimits& of(size_t traderId) const { return traders[traderId]; }
+};
+
+// The limits in force, swapped whole on reload. Matching threads read the current
+// table through an atomic pointer, so a reload never blocks them. Replaced tables
+// are kept until destruction, as a matching thread may still be reading one.
+class RiskLimits {
+private:
+    std::string path;
+    size_t maxTraders;
+    std::vector<std::unique_ptr<RiskLimitTable>> tables;  // Every table loaded; touched by the reloading thread
+    std::atomic<const RiskLimitTable*> current{nullptr};
+
+public:
+    // Loads `path`; trader IDs from 0 to maxTraders - 1 can be given limits and trade
+    RiskLimits(const std::string& path, size_t maxTraders);
+
+    RiskLimits(const RiskLimits&) = delete;
+    RiskLimits& operator=(const RiskLimits&) = delete;
+
+    // Re-reads the file and publishes the new table. On error the limits in force
+    // stay and the exception propagates. One thread at a time.
+    void reload();
+
+    const RiskLimitTable& table() const { return *current.load(std::memory_order_acquire); }
+    size_t traderCount() const { return maxTraders; }
+    const std::string& file() const { return path; }
+    size_t reloads() const { return tables.size() - 1; }
+};
+
+#endif // RISK_LIMITS_H
@@ -0,0 +1,187 @@
+#include "ShardedEngine.h"
+#include "CpuAffinity.h"
+#include "Logger.h"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+ShardedEngine::ShardedEngine(size_t shardCount, const BookCapacity& capacity, size_t symbolCount,
+                             const std::vector<int>& cores, int rtPriority, const std::vector<LadderConfig>& ladders,
+                             size_t queueCapacity)
+    : running(true) {
+    if (shardCount == 0) {
+        throw std::invalid_argument("Shard count must be greater than zero.");
+    }
+
+    // Every shard gets a book slot for every symbol so symbol IDs index directly;
+    // only the books of the shard's own symbols are ever used, so only they get ladders
+    for (size_t i = 0; i < shardCount; ++i) {
+        int core = i < cores.size() ? cores[i] : -1;
+        std::vector<LadderConfig> owned(ladders.size());
+        for (size_t symbolId = i; symbolId < ladders.size(); symbolId += shardCount) {
+            owned[symbolId] = ladders[symbolId];
+        }
+        shards.push_back(std::make_unique<Shard>(capacity, symbolCount, owned, queueCapacity, i, core, rtPriority));
+    }
+    for (auto& shard : shards) {
+        Shard* s = shard.get();
+        s->thread = std::thread([this, s]() { run(*s); });
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    stop();
+}
+
+void ShardedEngine::stop() {
+    running.store(false, std::memory_order_release);
+    for (auto& shard : shards) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+void ShardedEngine::processMessage(const OrderMessage& message, ExecutionReport& report) {
+    report.clear();
+    report.orderId = message.order.orderId;
+
+    // Each shard snapshots at this point in its own queue, so every part reflects
+    // the same journal position. Every queue is checked first, so the marker
+    // reaches all shards or none: this thread is the only producer, and the
+    // shards only ever make more room.
+    if (message.type == MessageType::Snapshot) {
+        for (auto& shard : shards) {
+            if (shard->inbound.size() >= shard->inbound.capacity()) {
+                throw std::runtime_error("Matching queue full for shard " + std::to_string(shard->index));
+            }
+        }
+        for (auto& shard : shards) {
+            shard->inbound.tryPush(message);
+            ++shard->pushed;
+        }
+        report.queued = true;
+        return;
+    }
+
+    Shard& shard = *shards[shardFor(message.order.symbolId)];
+    if (!shard.inbound.tryPush(message)) {
+        throw std::runtime_error("Matching queue full for symbol ID " + std::to_string(message.order.symbolId));
+    }
+    ++shard.pushed;
+    report.queued = true;
+}
+
+void ShardedEngine::setPriceBand(int64_t ticks) {
+    for (auto& shard : shards) {
+        shard->engine.setPriceBand(ticks);
+    }
+}
+
+void ShardedEngine::enableRisk(const RiskLimits& limits, const std::vector<double>& tickSizes) {
+    for (auto& shard : shards) {
+        shard->engine.enableRisk(limits, tickSizes);
+    }
+}
+
+void ShardedEngine::enableSnapshots(const std::string& dir) {
+    for (auto& shard : shards) {
+        shard->engine.enableSnapshots(dir, static_cast<uint32_t>(shard->index), static_cast<uint32_t>(shards.size()));
+    }
+}
+
+// The shard threads only touch their engines for queued messages, and nothing is
+// queued yet; the first push publishes the loaded books to them
+void ShardedEngine::loadSnapshot(uint64_t sequence) {
+    for (auto& shard : shards) {
+        shard->engine.loadSnapshot(sequence);
+    }
+}
+
+void ShardedEngine::replayMessage(const OrderMessage& message, ExecutionReport& report) {
+    report.clear();
+    report.orderId = message.order.orderId;
+
+    Shard& shard = *shards[shardFor(message.order.symbolId)];
+    while (!shard.inbound.tryPush(message)) {
+        cpuRelax();  // Recovery runs before any client is served, so waiting is fine
+    }
+    ++shard.pushed;
+    report.queued = true;
+}
+
+void ShardedEngine::waitIdle() const {
+    for (const auto& shard : shards) {
+        while (shard->processed.load(std::memory_order_acquire) != shard->pushed) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// An idle shard thread only polls its ring, so its engine can be changed here;
+// the next push publishes the change to it
+void ShardedEngine::enableMarketData(const MarketDataConfig& config) {
+    waitIdle();
+    for (auto& shard : shards) {
+        shard->engine.enableMarketData(config, static_cast<uint16_t>(shard->index));
+    }
+}
+
+std::string ShardedEngine::statsReport() const {
+    std::ostringstream oss;
+    for (const auto& shard : shards) {
+        oss << "shard " << shard->index << ": depth=" << shard->inbound.size()
+            << "/" << shard->inbound.capacity() << "\n"
+            << shard->engine.statsReport();
+    }
+    return oss.str();
+}
+
+// Matching thread: spins on its ring while work is arriving and yields the CPU
+// once it has been idle for a while, so an oversubscribed host still makes progress
+void ShardedEngine::run(Shard& shard) {
+    Logger& logger = Logger::getInstance();
+    size_t index = shard.index;
+
+    if (shard.core >= 0 || shard.rtPriority > 0) {
+        logger.log("Matching shard " + std::to_string(index) + " " + placeCurrentThread(shard.core, shard.rtPriority));
+    }
+
+    int idleSpins = 0;
+    OrderMessage message;
+    ExecutionReport report;   // Fills are only logged; the sender was answered when the request was queued
+
+    // Processes everything currently queued, then commits it as one batch;
+    // returns false if the ring was empty
+    auto drain = [&]() {
+        uint64_t handled = 0;
+        while (shard.inbound.tryPop(message)) {
+            ++handled;
+            try {
+                shard.engine.processMessage(message, report);
+            } catch (const std::exception& e) {
+                logger.log("Shard " + std::to_string(index) + " rejected order " +
+                           std::to_string(message.order.orderId) + ": " + e.what(), LogLevel::Warn);
+            }
+        }
+        if (handled == 0) {
+            return false;
+        }
+        shard.engine.commit();
+        shard.processed.fetch_add(handled, std::memory_order_release);
+        return true;
+    };
+
+    while (running.load(std::memory_order_acquire)) {
+        if (drain()) {
+            idleSpins = 0;
+        } else if (++idleSpins < SPINS_BEFORE_YIELD) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    // Anything queued before the stop is still matched
+    drain();
+}
@@ -0,0 +1,92 @@
+#ifndef SHARDED_ENGINE_H
+#define SHARDED_ENGINE_H
+
+#include "MatchingEngine.h"
+#include "Message.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Spreads instruments over several matching threads. Each shard owns a
+// MatchingEngine with the books of the symbols assigned to it (symbolId modulo
+// the shard count) and runs it on a dedicated thread, optionally pinned to a
+// core. The network thread is the only producer for every shard's inbound ring,
+// so the rings are single-producer/single-consumer and lock-free.
+class ShardedEngine : public OrderHandler {
+private:
+    struct Shard {
+        MatchingEngine engine;
+        SpscRing<OrderMessage> inbound;
+        std::thread thread;
+        size_t index;
+        int core;                           // CPU to pin to, -1 for none
+        int rtPriority;                     // SCHED_FIFO priority, 0 for the normal scheduler
+        uint64_t pushed = 0;                // Messages queued, counted by the producer
+        std::atomic<uint64_t> processed{0}; // Messages handled and committed, counted by the shard
+
+        Shard(const BookCapacity& capacity, size_t symbolCount, const std::vector<LadderConfig>& ladders,
+              size_t queueCapacity, size_t index, int core, int rtPriority)
+            : engine(capacity, symbolCount, ladders), inbound(queueCapacity), index(index), core(core),
+              rtPriority(rtPriority) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> running;
+
+    void run(Shard& shard);
+
+    // Waits until every shard has handled everything queued so far
+    void waitIdle() const;
+
+public:
+    // `cores` lists the CPU for each shard in order; missing entries leave that shard unpinned.
+    // A non-zero `rtPriority` runs every shard thread under SCHED_FIFO at that priority.
+    // `capacity` is the book memory of each shard; `ladders` as for MatchingEngine.
+    ShardedEngine(size_t shardCount, const BookCapacity& capacity, size_t symbolCount,
+                  const std::vector<int>& cores, int rtPriority, const std::vector<LadderConfig>& ladders = {},
+                  size_t queueCapacity = 1 << 16);
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    // Hands the request to the shard that owns its symbol and marks the report as
+    // queued. A Snapshot request goes to every shard. Must be called from a single thread. Throws std::runtime_error if
+    // that shard's queue is full.
+    void processMessage(const OrderMessage& message, ExecutionReport& report) override;
+
+    // Like processMessage, but waits for room in the shard's queue instead of throwing
+    void replayMessage(const OrderMessage& message, ExecutionReport& report) override;
+
+    // A "shard <i>:" line with the inbound queue depth, then that shard's engine report
+    std::string statsReport() const override;
+
+    // Sets every shard's market order protection band. Call before any message is queued.
+    void setPriceBand(int64_t ticks);
+
+    // Turns on risk checks in every shard; each keeps the positions and order rate
+    // of the symbols it owns. Call before any message is queued.
+    void enableRisk(const RiskLimits& limits, const std::vector<double>& tickSizes);
+
+    // Each shard writes its own part of every snapshot into `dir`
+    void enableSnapshots(const std::string& dir);
+
+    // Loads every shard's part of snapshot `sequence`. Call before any message is queued.
+    void loadSnapshot(uint64_t sequence);
+
+    // Publishes each shard's market data as stream <shard index>. Waits for the
+    // queues to drain first, so call it from the producer thread.
+    void enableMarketData(const MarketDataConfig& config);
+
+    // Lets every shard finish its queue, then joins the threads
+    void stop();
+
+    size_t shardCount() const { return shards.size(); }
+    size_t shardFor(uint32_t symbolId) const { return symbolId % shards.size(); }
+};
+
+#endif // SHARDED_ENGINE_H
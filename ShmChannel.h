@@ -0,0 +1,137 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// A shared-memory channel between the engine and one local client process: a
+// request ring the client writes and the engine reads, and a response ring the
+// other way. Each ring is single-producer single-consumer over fixed-size slots,
+// and a slot carries one message exactly as it would arrive in a datagram, text
+// or binary. Both sides spin on the rings; nothing goes through the kernel.
+//
+// The engine creates the segments /<prefix>.0 ... /<prefix>.<n-1> at startup
+// (see ShmTransport); a client attaches to one it finds unowned (see ShmClient).
+// Layout, little-endian, offsets in bytes with S = slotCount * SHM_SLOT_SIZE:
+//
+//   0          ShmChannelHeader
+//   64         request ring: head (u64) at 64, tail (u64) at 128, slots at 192
+//   192 + S    response ring: head at 192 + S, tail at 256 + S, slots at 320 + S
+//
+// A slot is a u32 length followed by the message. The producer writes slots from
+// `head` on and then advances `head`; the consumer reads from `tail` and then
+// advances `tail`. Head and tail count slots and never wrap.
+
+constexpr uint32_t SHM_MAGIC = 0x4D485341;     // "ASHM"
+constexpr uint16_t SHM_VERSION = 1;
+constexpr size_t SHM_SLOT_SIZE = 2048;
+constexpr size_t SHM_PAYLOAD = SHM_SLOT_SIZE - sizeof(uint32_t);  // Largest message in a slot
+
+struct alignas(64) ShmCursor {
+    std::atomic<uint64_t> value;
+};
+
+struct ShmRingHeader {
+    ShmCursor head;  // Next slot to write (producer)
+    ShmCursor tail;  // Next slot to read (consumer)
+};
+
+struct alignas(64) ShmChannelHeader {
+    uint32_t magic;                 // SHM_MAGIC once the engine has initialized the segment
+    uint16_t version;               // SHM_VERSION
+    uint16_t reserved;
+    uint32_t slotCount;             // Per ring, a power of two
+    uint32_t slotSize;              // SHM_SLOT_SIZE
+    std::atomic<uint32_t> owner;    // Process ID of the attached client, 0 if free
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring cursors must be lock-free across processes");
+static_assert(sizeof(ShmChannelHeader) == 64, "ShmChannelHeader layout changed");
+static_assert(sizeof(ShmRingHeader) == 128, "ShmRingHeader layout changed");
+
+// Bytes of a channel segment with `slotCount` slots per ring
+inline size_t shmChannelSize(size_t slotCount) {
+    return sizeof(ShmChannelHeader) + 2 * (sizeof(ShmRingHeader) + slotCount * SHM_SLOT_SIZE);
+}
+
+// One side's view of a ring in a mapped segment. The producer and the consumer
+// each hold their own view, which caches the other side's cursor so the shared
+// cache line is only read when the cached value says the ring is full or empty.
+// Slots are claimed `ahead` places past the cursor, so a batch can be written or
+// read before it is published or released in one store.
+class ShmRing {
+private:
+    ShmRingHeader* header;
+    char* slots;
+    uint64_t mask;
+    uint64_t cachedOther = 0;  // Tail for the producer, head for the consumer
+
+    char* slot(uint64_t position) const { return slots + (position & mask) * SHM_SLOT_SIZE; }
+
+public:
+    ShmRing() : header(nullptr), slots(nullptr), mask(0) {}
+    ShmRing(void* ring, size_t slotCount)
+        : header(static_cast<ShmRingHeader*>(ring)),
+          slots(static_cast<char*>(ring) + sizeof(ShmRingHeader)), mask(slotCount - 1) {}
+
+    // Producer: payload of the slot `ahead` places past head, or nullptr if the ring is full there
+    char* claim(size_t ahead) {
+        uint64_t position = header->head.value.load(std::memory_order_relaxed) + ahead;
+        if (position - cachedOther > mask) {
+            cachedOther = header->tail.value.load(std::memory_order_acquire);
+            if (position - cachedOther > mask)
+                return nullptr;
+        }
+        return slot(position) + sizeof(uint32_t);
+    }
+
+    // Producer: sets the length of a claimed slot's message
+    static void setLength(char* payload, uint32_t length) {
+        std::memcpy(payload - sizeof(uint32_t), &length, sizeof(length));
+    }
+
+    // Producer: makes `count` claimed slots visible to the consumer
+    void publish(size_t count) {
+        header->head.value.store(header->head.value.load(std::memory_order_relaxed) + count,
+                                 std::memory_order_release);
+    }
+
+    // Consumer: payload of the slot `ahead` places past tail, or nullptr if it is not published yet
+    char* peek(size_t ahead, uint32_t& length) {
+        uint64_t position = header->tail.value.load(std::memory_order_relaxed) + ahead;
+        if (position >= cachedOther) {
+            cachedOther = header->head.value.load(std::memory_order_acquire);
+            if (position >= cachedOther)
+                return nullptr;
+        }
+        char* data = slot(position);
+        std::memcpy(&length, data, sizeof(length));
+        return data + sizeof(uint32_t);
+    }
+
+    // Consumer: hands `count` read slots back to the producer
+    void release(size_t count) {
+        header->tail.value.store(header->tail.value.load(std::memory_order_relaxed) + count,
+                                 std::memory_order_release);
+    }
+
+    // Consumer: drops everything published so far, e.g. replies meant for a previous client
+    void discard() {
+        header->tail.value.store(header->head.value.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
+
+// The two rings of a mapped channel segment
+inline ShmRing shmRequests(void* base, size_t slotCount) {
+    return ShmRing(static_cast<char*>(base) + sizeof(ShmChannelHeader), slotCount);
+}
+
+inline ShmRing shmResponses(void* base, size_t slotCount) {
+    return ShmRing(static_cast<char*>(base) + sizeof(ShmChannelHeader) + sizeof(ShmRingHeader) +
+                       slotCount * SHM_SLOT_SIZE,
+                   slotCount);
+}
+
+#endif // SHM_CHANNEL_H
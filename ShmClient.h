@@ -0,0 +1,150 @@
+#ifndef SHM_CLIENT_H
+#define SHM_CLIENT_H
+
+#include "ShmChannel.h"
+#include "CpuAffinity.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Client side of a shared-memory channel, for order senders on the engine's host
+// (run with --shm-name). Header-only, so a strategy only needs this file,
+// ShmChannel.h and CpuAffinity.h. Requests and replies are the same text or
+// binary messages as over UDP:
+//
+//   ShmClient client("matching");
+//   char reply[ShmClient::MAX_REPLY];
+//   size_t length = client.request(order, orderLength, reply, sizeof(reply));
+//
+// One thread at a time may use a client.
+class ShmClient {
+private:
+    char* base = nullptr;
+    size_t size = 0;
+    ShmChannelHeader* header = nullptr;
+    ShmRing requests;   // Client side: producer
+    ShmRing responses;  // Client side: consumer
+    std::string name;
+
+    // Maps /<prefix>.<index> and claims it; false if it is in use. A channel whose
+    // owner has exited is taken over.
+    bool attach(const std::string& candidate) {
+        int fd = shm_open(candidate.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                throw std::out_of_range(candidate);
+            }
+            return false;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ShmChannelHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+
+        auto* candidateHeader = static_cast<ShmChannelHeader*>(mapped);
+        uint32_t owner = candidateHeader->owner.load(std::memory_order_acquire);
+        bool usable = candidateHeader->magic == SHM_MAGIC && candidateHeader->version == SHM_VERSION &&
+                      candidateHeader->slotSize == SHM_SLOT_SIZE && candidateHeader->slotCount != 0 &&
+                      (candidateHeader->slotCount & (candidateHeader->slotCount - 1)) == 0 &&
+                      static_cast<size_t>(info.st_size) >= shmChannelSize(candidateHeader->slotCount);
+        bool stale = owner != 0 && kill(static_cast<pid_t>(owner), 0) < 0 && errno == ESRCH;
+        if (!usable || (owner != 0 && !stale) ||
+            !candidateHeader->owner.compare_exchange_strong(owner, static_cast<uint32_t>(getpid()))) {
+            munmap(mapped, info.st_size);
+            return false;
+        }
+
+        base = static_cast<char*>(mapped);
+        size = info.st_size;
+        header = candidateHeader;
+        requests = shmRequests(base, header->slotCount);
+        responses = shmResponses(base, header->slotCount);
+        responses.discard();  // Replies to whoever held the channel before
+        name = candidate;
+        return true;
+    }
+
+public:
+    static constexpr size_t MAX_REQUEST = 1024;  // The engine cuts longer requests short
+    static constexpr size_t MAX_REPLY = SHM_PAYLOAD;
+
+    // Attaches to the first free channel of an engine started with --shm-name <prefix>
+    explicit ShmClient(const std::string& prefix) {
+        for (size_t index = 0;; ++index) {
+            try {
+                if (attach("/" + prefix + "." + std::to_string(index))) {
+                    return;
+                }
+            } catch (const std::out_of_range&) {
+                throw std::runtime_error("No free shared-memory channel for " + prefix);
+            }
+        }
+    }
+
+    ~ShmClient() {
+        header->owner.store(0, std::memory_order_release);
+        munmap(base, size);
+    }
+
+    ShmClient(const ShmClient&) = delete;
+    ShmClient& operator=(const ShmClient&) = delete;
+
+    const std::string& channel() const { return name; }
+
+    // Queues one request; false if the request ring is full
+    bool trySend(const void* data, size_t length) {
+        if (length > MAX_REQUEST) {
+            throw std::length_error("Request longer than " + std::to_string(MAX_REQUEST) + " bytes");
+        }
+        char* slot = requests.claim(0);
+        if (!slot) {
+            return false;
+        }
+        std::memcpy(slot, data, length);
+        ShmRing::setLength(slot, static_cast<uint32_t>(length));
+        requests.publish(1);
+        return true;
+    }
+
+    // Copies the next reply into `out` (truncated to `capacity`) and returns its
+    // length, or 0 if none has arrived
+    size_t tryReceive(char* out, size_t capacity) {
+        uint32_t length;
+        const char* slot = responses.peek(0, length);
+        if (!slot) {
+            return 0;
+        }
+        size_t copied = length < capacity ? length : capacity;
+        std::memcpy(out, slot, copied);
+        responses.release(1);
+        return copied;
+    }
+
+    // Sends a request and spins until its reply arrives. Control commands that
+    // are not answered, such as "shutdown", would spin forever; use trySend.
+    size_t request(const void* data, size_t length, char* out, size_t capacity) {
+        while (!trySend(data, length)) {
+            cpuRelax();
+        }
+        for (;;) {
+            if (size_t received = tryReceive(out, capacity)) {
+                return received;
+            }
+            cpuRelax();
+        }
+    }
+};
+
+#endif // SHM_CLIENT_H
@@ -0,0 +1,133 @@
+#include "ShmTransport.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ShmTransport::ShmTransport(NetworkInterface& network, const std::string& prefix, size_t clients, size_t slots)
+    : network(network), slotCount(1) {
+    if (slots == 0 || clients == 0) {
+        throw std::invalid_argument("Shared-memory transport needs at least one client and one slot.");
+    }
+    while (slotCount < slots)
+        slotCount <<= 1;
+    segmentSize = shmChannelSize(slotCount);
+
+    channels.resize(clients);
+    for (size_t i = 0; i < clients; ++i) {
+        Channel& channel = channels[i];
+        channel.name = "/" + prefix + "." + std::to_string(i);
+
+        // A fresh object, so clients still mapping a previous run's segment are cut off
+        shm_unlink(channel.name.c_str());
+        int fd = shm_open(channel.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to create shared memory " + channel.name + ": " + std::strerror(errno));
+        }
+        if (ftruncate(fd, static_cast<off_t>(segmentSize)) < 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to size shared memory " + channel.name + ".");
+        }
+        void* base = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map shared memory " + channel.name + ".");
+        }
+        channel.base = static_cast<char*>(base);
+
+        auto* header = new (channel.base) ShmChannelHeader{};
+        new (channel.base + sizeof(ShmChannelHeader)) ShmRingHeader{};
+        new (channel.base + sizeof(ShmChannelHeader) + sizeof(ShmRingHeader) + slotCount * SHM_SLOT_SIZE)
+            ShmRingHeader{};
+        header->version = SHM_VERSION;
+        header->slotCount = static_cast<uint32_t>(slotCount);
+        header->slotSize = static_cast<uint32_t>(SHM_SLOT_SIZE);
+        header->owner.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = SHM_MAGIC;  // Last, so a client never attaches to a half-built segment
+
+        channel.requests = shmRequests(channel.base, slotCount);
+        channel.responses = shmResponses(channel.base, slotCount);
+    }
+}
+
+ShmTransport::~ShmTransport() {
+    for (Channel& channel : channels) {
+        if (channel.base) {
+            munmap(channel.base, segmentSize);
+            shm_unlink(channel.name.c_str());
+        }
+    }
+}
+
+// Replies are written straight into the response ring's slots and a request is
+// only taken when a slot for its reply is free, so a client that stops reading
+// replies only holds up its own requests
+size_t ShmTransport::poll(OrderHandler& engine) {
+    size_t taken = 0;
+    for (Channel& channel : channels) {
+        while (channel.taken < MAX_PER_POLL && network.running()) {
+            uint32_t length;
+            char* request = channel.requests.peek(channel.taken, length);
+            if (!request) {
+                break;
+            }
+            char* response = channel.responses.claim(channel.replies);
+            if (!response) {
+                relaxedAdd(stalls, 1);
+                break;
+            }
+            ++channel.taken;
+
+            // Decoded in place: the slot has room for the terminator. Longer requests
+            // are cut short, as a datagram would be.
+            length = std::min<uint32_t>(length, NetworkInterface::MAX_DATAGRAM);
+            OrderMessage message;
+            size_t responseLength = 0;
+            if (network.decodeDatagram(request, length, message, response, responseLength)) {
+                responseLength = network.executeMessage(message, request, length, engine, response);
+            }
+            if (responseLength > 0) {
+                ShmRing::setLength(response, static_cast<uint32_t>(responseLength));
+                ++channel.replies;
+            }
+        }
+        taken += channel.taken;
+    }
+    if (taken == 0) {
+        return 0;
+    }
+
+    engine.commit();  // Nothing is acknowledged before it is journaled
+    for (Channel& channel : channels) {
+        if (channel.replies) {
+            channel.responses.publish(channel.replies);
+        }
+        if (channel.taken) {
+            channel.requests.release(channel.taken);
+        }
+        channel.taken = 0;
+        channel.replies = 0;
+    }
+    relaxedAdd(requests, taken);
+    return taken;
+}
+
+std::string ShmTransport::report() const {
+    std::ostringstream oss;
+    size_t attached = 0;
+    for (const Channel& channel : channels) {
+        const auto* header = reinterpret_cast<const ShmChannelHeader*>(channel.base);
+        attached += header->owner.load(std::memory_order_relaxed) != 0;
+    }
+    oss << "shm: channels=" << channels.size() << " attached=" << attached
+        << " requests=" << requests.load(std::memory_order_relaxed)
+        << " stalls=" << stalls.load(std::memory_order_relaxed) << "\n";
+    return oss.str();
+}
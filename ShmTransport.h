@@ -0,0 +1,54 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include "NetworkInterface.h"
+#include "Message.h"
+#include "ShmChannel.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Order entry for client processes on the same host, over shared-memory rings
+// (see ShmChannel.h). Creates one channel segment per client slot and serves
+// them from the network thread, between socket receives: requests go through the
+// same decoding and execution as datagrams, are committed together, and only then
+// are their replies published.
+class ShmTransport {
+private:
+    struct Channel {
+        std::string name;           // shm_open name, "/<prefix>.<n>"
+        char* base = nullptr;
+        ShmRing requests;           // Engine side: consumer
+        ShmRing responses;          // Engine side: producer
+        size_t taken = 0;           // Requests read this poll, released after the commit
+        size_t replies = 0;         // Replies written this poll, published after the commit
+    };
+
+    NetworkInterface& network;
+    std::vector<Channel> channels;
+    size_t slotCount;
+    size_t segmentSize;
+
+    std::atomic<uint64_t> requests{0};      // Written by the polling thread only
+    std::atomic<uint64_t> stalls{0};        // Polls that found a response ring full
+
+public:
+    static constexpr size_t MAX_PER_POLL = 64;  // Requests taken from one channel per poll
+
+    // Creates /<prefix>.0 ... /<prefix>.<clients-1>, replacing any left by an
+    // earlier run, with `slots` (rounded up to a power of two) per ring
+    ShmTransport(NetworkInterface& network, const std::string& prefix, size_t clients, size_t slots);
+    ~ShmTransport();  // Unmaps and unlinks the segments
+
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    // Serves what the clients have queued; returns the number of requests taken
+    size_t poll(OrderHandler& engine);
+
+    // Request and stall counters, for statsReport(); safe from any thread
+    std::string report() const;
+};
+
+#endif // SHM_TRANSPORT_H
@@ -0,0 +1,178 @@
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Parses "snapshot.<sequence>.<part>"; false for any other name
+bool parseName(const char* name, uint64_t& sequence, uint32_t& part) {
+    unsigned long long seq;
+    unsigned int index;
+    int consumed = 0;
+    if (std::sscanf(name, "snapshot.%llu.%u%n", &seq, &index, &consumed) != 2 || name[consumed] != '\0') {
+        return false;
+    }
+    sequence = seq;
+    part = index;
+    return true;
+}
+
+// Sequences of every snapshot file in `dir`, as (sequence, part) pairs
+std::vector<std::pair<uint64_t, uint32_t>> listSnapshots(const std::string& dir) {
+    std::vector<std::pair<uint64_t, uint32_t>> found;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return found;
+    }
+    while (dirent* entry = readdir(handle)) {
+        uint64_t sequence;
+        uint32_t part;
+        if (parseName(entry->d_name, sequence, part)) {
+            found.emplace_back(sequence, part);
+        }
+    }
+    closedir(handle);
+    return found;
+}
+
+// Sequences, ascending, for which every one of `parts` files is in `found`
+std::vector<uint64_t> completeSnapshots(std::vector<std::pair<uint64_t, uint32_t>> found, uint32_t parts) {
+    std::sort(found.begin(), found.end());
+    std::vector<uint64_t> complete;
+    for (size_t i = 0; i < found.size();) {
+        uint64_t sequence = found[i].first;
+        uint32_t present = 0;
+        size_t j = i;
+        for (; j < found.size() && found[j].first == sequence; ++j) {
+            if (found[j].second < parts) {
+                ++present;
+            }
+        }
+        if (present == parts) {
+            complete.push_back(sequence);
+        }
+        i = j;
+    }
+    return complete;
+}
+
+bool writeAll(int fd, const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = ::write(fd, bytes, length);
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const char* tempPath) : buffered(0), written(0), failed(false) {
+    fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    failed = fd < 0;
+
+    // Room for the header, which is written last once the order count is known
+    SnapshotHeader placeholder{};
+    failed = failed || !writeAll(fd, &placeholder, sizeof(placeholder));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void SnapshotWriter::flush() {
+    failed = failed || !writeAll(fd, buffer, buffered * sizeof(SnapshotOrder));
+    buffered = 0;
+}
+
+void SnapshotWriter::add(const Order& order) {
+    SnapshotOrder& record = buffer[buffered];
+    record = SnapshotOrder{};
+    record.price = order.price;
+    record.symbolId = order.symbolId;
+    record.orderId = order.orderId;
+    record.quantity = order.quantity;
+    record.timestamp = order.timestamp;
+    record.traderId = order.traderId;
+    record.side = order.side;
+    record.isMarketOrder = order.isMarketOrder ? 1 : 0;
+    ++written;
+    if (++buffered == BUFFER_ORDERS) {
+        flush();
+    }
+}
+
+bool SnapshotWriter::finish(SnapshotHeader header, const char* tempPath, const char* finalPath) {
+    flush();
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.orderCount = written;
+    failed = failed || pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header));
+    failed = failed || fsync(fd) < 0;
+    if (failed) {
+        unlink(tempPath);
+        return false;
+    }
+    return rename(tempPath, finalPath) == 0;
+}
+
+std::string snapshotPath(const std::string& dir, uint64_t sequence, uint32_t part) {
+    return dir + "/snapshot." + std::to_string(sequence) + "." + std::to_string(part);
+}
+
+uint64_t latestSnapshot(const std::string& dir, uint32_t parts) {
+    std::vector<uint64_t> complete = completeSnapshots(listSnapshots(dir), parts);
+    return complete.empty() ? 0 : complete.back();
+}
+
+void pruneSnapshots(const std::string& dir, uint32_t part, uint32_t parts, size_t keep) {
+    auto found = listSnapshots(dir);
+    std::vector<uint64_t> complete = completeSnapshots(found, parts);
+    if (keep == 0 || complete.size() < keep) {
+        return;
+    }
+    // Anything older than the oldest set kept goes, whole or not; newer files
+    // may belong to a set other parts are still writing
+    uint64_t oldestKept = complete[complete.size() - keep];
+    for (const auto& [sequence, index] : found) {
+        if (index == part && sequence < oldestKept) {
+            unlink(snapshotPath(dir, sequence, part).c_str());
+        }
+    }
+}
+
+SnapshotHeader readSnapshot(const std::string& path, const std::function<void(const Order&)>& fn) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open snapshot " + path);
+    }
+
+    SnapshotHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != SNAPSHOT_MAGIC ||
+        header.version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Not a version " + std::to_string(SNAPSHOT_VERSION) + " snapshot: " + path);
+    }
+
+    SnapshotOrder record;
+    for (uint64_t i = 0; i < header.orderCount; ++i) {
+        if (!in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            throw std::runtime_error("Truncated snapshot " + path);
+        }
+        fn(Order(record.orderId, record.side, record.price, record.quantity, record.timestamp, record.traderId,
+                 record.isMarketOrder != 0, record.symbolId));
+    }
+    return header;
+}
@@ -0,0 +1,92 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Binary image of the books of one MatchingEngine (one "part"; a sharded engine
+// writes one part per shard). A header is followed by SnapshotHeader::orderCount
+// orders in the priority order of OrderBook::forEachOrder. Files are named
+// snapshot.<sequence>.<part> and `sequence` is the last journal record applied,
+// so recovery replays only the journal after it.
+
+#pragma pack(push, 1)
+
+struct SnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t part;          // Shard index, 0 without sharding
+    uint32_t parts;         // Shard count, 1 without sharding
+    uint32_t symbolCount;
+    uint64_t sequence;      // Last journal record reflected in the books
+    uint64_t orderCount;
+    uint64_t reserved;
+};
+
+struct SnapshotOrder {
+    int64_t price;          // Ticks
+    int64_t orderId;
+    int64_t timestamp;
+    uint32_t symbolId;
+    int32_t quantity;
+    int32_t traderId;
+    char side;
+    uint8_t isMarketOrder;
+    uint8_t reserved[2];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(SnapshotHeader) == 48, "SnapshotHeader layout changed");
+static_assert(sizeof(SnapshotOrder) == 40, "SnapshotOrder layout changed");
+
+constexpr uint64_t SNAPSHOT_MAGIC = 0x31504E53534D4Full;  // "OMSSNP1"
+constexpr uint32_t SNAPSHOT_VERSION = 2;   // 2: 64-bit order IDs and timestamps
+
+// Streams one snapshot file through a fixed buffer with plain system calls. It
+// never allocates, so it is safe in a child forked from a multithreaded process.
+class SnapshotWriter {
+private:
+    static constexpr size_t BUFFER_ORDERS = 1024;
+
+    int fd;
+    SnapshotOrder buffer[BUFFER_ORDERS];
+    size_t buffered;
+    uint64_t written;
+    bool failed;
+
+    void flush();
+
+public:
+    // Creates `tempPath`, truncating any leftover from an earlier attempt
+    explicit SnapshotWriter(const char* tempPath);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void add(const Order& order);
+
+    // Writes the header, syncs, and renames the file to `finalPath`. Returns false
+    // if any step failed; the final name then never appears.
+    bool finish(SnapshotHeader header, const char* tempPath, const char* finalPath);
+};
+
+// <dir>/snapshot.<sequence>.<part>
+std::string snapshotPath(const std::string& dir, uint64_t sequence, uint32_t part);
+
+// Newest sequence for which all `parts` files exist, or 0 if there is none
+uint64_t latestSnapshot(const std::string& dir, uint32_t parts);
+
+// Deletes the snapshots of `part` older than the `keep` newest complete sets of
+// `parts` files, so a set is never pruned before a newer one is whole
+void pruneSnapshots(const std::string& dir, uint32_t part, uint32_t parts, size_t keep);
+
+// Reads a snapshot, calling fn for every order in file order, and returns its
+// header. Throws std::runtime_error if the file is missing, truncated or foreign.
+SnapshotHeader readSnapshot(const std::string& path, const std::function<void(const Order&)>& fn);
+
+#endif // SNAPSHOT_H
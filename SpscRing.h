@@ -0,0 +1,75 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Slots are preallocated; the capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<T> slots;
+    size_t mask;
+
+    // Producer and consumer indices live on separate cache lines, each next to a
+    // cached copy of the other side's index to avoid reading it on every call
+    alignas(CACHE_LINE) std::atomic<size_t> head{0}; // Next slot to write (producer)
+    size_t cachedTail = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0}; // Next slot to read (consumer)
+    size_t cachedHead = 0;
+
+public:
+    explicit SpscRing(size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Ring capacity must be greater than zero.");
+        }
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool tryPush(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail > mask) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail > mask)
+                return false;
+        }
+        slots[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool tryPop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == cachedHead) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t == cachedHead)
+                return false;
+        }
+        item = slots[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items; exact only when called from either end
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask + 1; }
+};
+
+#endif // SPSC_RING_H
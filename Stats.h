@@ -0,0 +1,132 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Monotonic nanoseconds for latency measurements
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Single-writer counter update: a plain load and store, no locked instruction.
+// Other threads may read the counter at any time.
+inline void relaxedAdd(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline void relaxedMax(std::atomic<uint64_t>& peak, uint64_t value) {
+    if (value > peak.load(std::memory_order_relaxed)) {
+        peak.store(value, std::memory_order_relaxed);
+    }
+}
+
+// Log-linear latency histogram in the style of HdrHistogram. Values below 64 ns
+// get a bucket each; above that every power of two is split into 32 buckets, so a
+// reported percentile is at most ~3% above the true value. Recording is a bit scan
+// and two relaxed stores. One thread records; any thread may read.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 5;                   // 32 buckets per power of two
+    static constexpr int LINEAR_BITS = SUB_BUCKET_BITS + 1;     // 0..63 ns are exact
+    static constexpr int MAX_BITS = 40;                         // Values are capped at ~18 minutes
+    static constexpr size_t BUCKETS = (size_t{1} << LINEAR_BITS) +
+                                      (MAX_BITS - LINEAR_BITS) * (size_t{1} << SUB_BUCKET_BITS);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+
+    static size_t bucketFor(uint64_t value) {
+        if (value < (uint64_t{1} << LINEAR_BITS)) {
+            return static_cast<size_t>(value);
+        }
+        value = std::min(value, (uint64_t{1} << MAX_BITS) - 1);
+        int magnitude = 63 - __builtin_clzll(value);
+        int shift = magnitude - SUB_BUCKET_BITS;
+        size_t sub = static_cast<size_t>(value >> shift) - (size_t{1} << SUB_BUCKET_BITS);
+        return (size_t{1} << LINEAR_BITS) + static_cast<size_t>(magnitude - LINEAR_BITS) * (size_t{1} << SUB_BUCKET_BITS) + sub;
+    }
+
+    // Largest value that lands in the bucket
+    static uint64_t upperBound(size_t bucket) {
+        if (bucket < (size_t{1} << LINEAR_BITS)) {
+            return bucket;
+        }
+        size_t offset = bucket - (size_t{1} << LINEAR_BITS);
+        int magnitude = static_cast<int>(offset >> SUB_BUCKET_BITS) + LINEAR_BITS;
+        uint64_t sub = (offset & ((size_t{1} << SUB_BUCKET_BITS) - 1)) + (uint64_t{1} << SUB_BUCKET_BITS);
+        return ((sub + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+    }
+
+public:
+    void record(uint64_t ns) {
+        relaxedAdd(counts[bucketFor(ns)], 1);
+        relaxedAdd(total, 1);
+        relaxedAdd(sum, ns);
+        relaxedMax(max, ns);
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+    // Adds every sample of `other`, which must no longer be recorded to. Only this
+    // histogram's recording thread may call it.
+    void merge(const LatencyHistogram& other) {
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            relaxedAdd(counts[bucket], other.counts[bucket].load(std::memory_order_relaxed));
+        }
+        relaxedAdd(total, other.total.load(std::memory_order_relaxed));
+        relaxedAdd(sum, other.sum.load(std::memory_order_relaxed));
+        relaxedMax(max, other.max.load(std::memory_order_relaxed));
+    }
+
+    // Forgets every sample. Only the recording thread may call it.
+    void reset() {
+        for (auto& bucket : counts) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+    // Smallest recorded bucket bound with at least `fraction` of the samples at or below it
+    uint64_t percentile(double fraction) const {
+        uint64_t samples = count();
+        if (samples == 0) {
+            return 0;
+        }
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * samples + 0.5));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += counts[bucket].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                return std::min(upperBound(bucket), max.load(std::memory_order_relaxed));
+            }
+        }
+        return max.load(std::memory_order_relaxed);
+    }
+
+    // "<name>: n=<count> mean=<ns> p50=<ns> p99=<ns> p99.9=<ns> max=<ns>"
+    std::string summary(const char* name) const {
+        uint64_t samples = count();
+        std::ostringstream oss;
+        oss << name << ": n=" << samples
+            << " mean=" << (samples ? sum.load(std::memory_order_relaxed) / samples : 0)
+            << "ns p50=" << percentile(0.50)
+            << "ns p99=" << percentile(0.99)
+            << "ns p99.9=" << percentile(0.999)
+            << "ns max=" << max.load(std::memory_order_relaxed) << "ns";
+        return oss.str();
+    }
+};
+
+#endif // STATS_H
@@ -0,0 +1,110 @@
+#ifndef SYMBOL_DIRECTORY_H
+#define SYMBOL_DIRECTORY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reference data for one tradable instrument
+struct Instrument {
+    uint32_t symbolId;      // Dense ID, index into the directory
+    std::string symbol;     // Name used on the text wire format
+    double tickSize;        // Price increment; prices are converted to ticks on ingress
+    int64_t ladderLow = 0;  // Ticks; lowest price the book keeps in its dense ladder
+    size_t ladderTicks = 0; // Width of that ladder, 0 for a tree-only book
+};
+
+// Maps instrument names to dense symbol IDs and per-instrument reference data.
+// Built once at startup and read-only afterwards, so it is shared between threads.
+class SymbolDirectory {
+private:
+    std::vector<Instrument> instruments;
+    std::unordered_map<std::string, uint32_t> idsBySymbol;
+
+public:
+    static constexpr const char* DEFAULT_SYMBOL = "DEFAULT";
+
+    // Adds an instrument and returns its symbol ID. With `ladderTicks`, its book keeps
+    // that many ticks centred on `referencePrice` in a dense price ladder.
+    uint32_t add(const std::string& symbol, double tickSize, double referencePrice = 0.0, size_t ladderTicks = 0) {
+        if (!(tickSize > 0.0)) {
+            throw std::invalid_argument("Tick size must be greater than zero for " + symbol);
+        }
+        uint32_t symbolId = static_cast<uint32_t>(instruments.size());
+        if (!idsBySymbol.emplace(symbol, symbolId).second) {
+            throw std::invalid_argument("Duplicate symbol " + symbol);
+        }
+        if (ladderTicks > 0 && !(referencePrice > 0.0)) {
+            throw std::invalid_argument("Ladder reference price must be greater than zero for " + symbol);
+        }
+        int64_t reference = std::llround(referencePrice / tickSize);
+        int64_t low = std::max<int64_t>(1, reference - static_cast<int64_t>(ladderTicks / 2));
+        instruments.push_back(Instrument{symbolId, symbol, tickSize, ladderTicks ? low : 0, ladderTicks});
+        return symbolId;
+    }
+
+    // Loads "<symbol> <tickSize> [<referencePrice> <ladderTicks>]" lines; blank lines
+    // and lines starting with '#' are skipped.
+    // Symbol IDs follow the order of the file, starting at 0.
+    static SymbolDirectory load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open symbol file " + path);
+        }
+
+        SymbolDirectory directory;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream ss(line);
+            std::string symbol;
+            double tickSize;
+            double referencePrice = 0.0;
+            size_t ladderTicks = 0;
+            if (!(ss >> symbol >> tickSize) || ((ss >> referencePrice) && !(ss >> ladderTicks))) {
+                throw std::invalid_argument("Malformed symbol line: " + line);
+            }
+            directory.add(symbol, tickSize, referencePrice, ladderTicks);
+        }
+        if (directory.size() == 0) {
+            throw std::invalid_argument("Symbol file " + path + " lists no instruments");
+        }
+        return directory;
+    }
+
+    // A directory with the single instrument used when no symbol file is given
+    static SymbolDirectory singleInstrument(double tickSize = 0.01) {
+        SymbolDirectory directory;
+        directory.add(DEFAULT_SYMBOL, tickSize);
+        return directory;
+    }
+
+    // Throws std::invalid_argument for an unknown name
+    uint32_t idOf(const std::string& symbol) const {
+        auto it = idsBySymbol.find(symbol);
+        if (it == idsBySymbol.end()) {
+            throw std::invalid_argument("Unknown symbol " + symbol);
+        }
+        return it->second;
+    }
+
+    // Throws std::invalid_argument for an unknown ID
+    const Instrument& at(uint32_t symbolId) const {
+        if (symbolId >= instruments.size()) {
+            throw std::invalid_argument("Unknown symbol ID " + std::to_string(symbolId));
+        }
+        return instruments[symbolId];
+    }
+
+    size_t size() const { return instruments.size(); }
+};
+
+#endif // SYMBOL_DIRECTORY_H
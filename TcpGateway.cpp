@@ -0,0 +1,503 @@
+#include "TcpGateway.h"
+#include "Logger.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+
+// epoll user data of the two sockets that are not sessions
+constexpr uint64_t LISTENER = ~uint64_t{0};
+constexpr uint64_t DATAGRAMS = ~uint64_t{0} - 1;
+
+constexpr int MAX_EVENTS = 256;
+constexpr int IDLE_WAIT_MS = 100;  // Bounds how long a stop takes to notice
+
+std::string describePeer(const sockaddr_in& peer) {
+    char address[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address));
+    return std::string(address) + ":" + std::to_string(ntohs(peer.sin_port));
+}
+
+// True if the text request is `command`, ignoring trailing whitespace
+bool isCommand(const char* data, size_t length, const char* command) {
+    while (length > 0 && (data[length - 1] == '\n' || data[length - 1] == '\r' || data[length - 1] == ' ')) {
+        --length;
+    }
+    return length == std::strlen(command) && std::memcmp(data, command, length) == 0;
+}
+
+} // namespace
+
+TcpGateway::TcpGateway(NetworkInterface& network, const GatewayConfig& config)
+    : network(network), config(config), sessions(config.maxSessions),
+      ownedPool(config.maxOwnedOrders), owners(config.maxOwnedOrders) {
+    // Buffers are allocated and touched up front, so accepting a client never allocates
+    for (Session& session : sessions) {
+        session.readBuffer.assign(READ_BUFFER, 0);
+        session.writeBuffer.assign(std::max(config.writeBufferBytes, 2 * MAX_FRAME), 0);
+    }
+    freeSessions.reserve(sessions.size());
+    for (size_t i = sessions.size(); i-- > 0;) {
+        freeSessions.push_back(static_cast<uint32_t>(i));
+    }
+    pending.reserve(sessions.size());
+    dirty.reserve(sessions.size());
+    dropCopies.reserve(sessions.size());
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error("Failed to create TCP socket.");
+    }
+    int enable = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(config.port);
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0) {
+        ::close(listenFd);
+        throw std::runtime_error("Failed to listen on TCP port " + std::to_string(config.port) + ".");
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        ::close(listenFd);
+        throw std::runtime_error("Failed to create epoll instance.");
+    }
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN | EPOLLET;
+    listenEvent.data.u64 = LISTENER;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent);
+
+    // Datagrams stay level-triggered: each readiness is served one batch at a time
+    epoll_event datagramEvent{};
+    datagramEvent.events = EPOLLIN;
+    datagramEvent.data.u64 = DATAGRAMS;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, network.getSocket(), &datagramEvent);
+
+    network.setExecutionListener([this](const OrderMessage& message, const ExecutionReport& report) {
+        onExecution(message, report);
+    });
+}
+
+TcpGateway::~TcpGateway() {
+    network.setExecutionListener(nullptr);
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        if (sessions[i].fd >= 0) {
+            ::close(sessions[i].fd);
+        }
+    }
+    ::close(epollFd);
+    ::close(listenFd);
+}
+
+void TcpGateway::run(OrderHandler& engine) {
+    Logger& logger = Logger::getInstance();
+    NetworkInterface::DatagramBatch datagrams(network.getBatchSize());
+    std::vector<epoll_event> events(MAX_EVENTS);
+    std::vector<uint32_t> servicing;
+    servicing.reserve(sessions.size());
+
+    while (network.running()) {
+        // Sessions left with input from the last pass must not wait for a new edge,
+        // and a local transport is polled on every pass
+        const int timeout =
+            network.getBusyPoll() || network.hasLocalTransport() || !pending.empty() ? 0 : IDLE_WAIT_MS;
+        int ready = epoll_wait(epollFd, events.data(), MAX_EVENTS, timeout);
+        if (ready < 0 && errno != EINTR) {
+            logger.log("Error: epoll_wait failed.", LogLevel::Error);
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            const epoll_event& event = events[i];
+            if (event.data.u64 == LISTENER) {
+                acceptSessions();
+                continue;
+            }
+            if (event.data.u64 == DATAGRAMS) {
+                network.serveBatch(datagrams, engine);  // Commits and replies itself
+                continue;
+            }
+            const uint32_t index = static_cast<uint32_t>(event.data.u64);
+            Session& session = sessions[index];
+            if (session.fd < 0) {
+                continue;
+            }
+            if (event.events & (EPOLLERR | EPOLLHUP)) {
+                close(index, "connection reset");
+                continue;
+            }
+            if (event.events & EPOLLOUT) {
+                flush(index);
+            }
+            if (event.events & (EPOLLIN | EPOLLRDHUP)) {
+                session.readable = true;  // A peer shutdown is seen as a 0-byte read after the data
+                markPending(index);
+            }
+        }
+
+        network.pollLocal(engine);  // Commits and publishes its replies itself
+
+        // Execute everything readable, then make it durable once before any reply goes out
+        servicing.swap(pending);
+        pending.clear();
+        bool executed = false;
+        for (uint32_t index : servicing) {
+            Session& session = sessions[index];
+            if (!session.pending) {
+                continue;
+            }
+            session.pending = false;
+            if (session.fd >= 0 && network.running()) {
+                executed |= service(index, engine);
+            }
+        }
+        if (executed) {
+            engine.commit();
+        }
+
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            const uint32_t index = dirty[i];
+            Session& session = sessions[index];
+            if (!session.dirty) {
+                continue;
+            }
+            session.dirty = false;
+            if (session.closing) {
+                relaxedAdd(slowConsumers, 1);
+                close(index, "write buffer overflow");
+                continue;
+            }
+            flush(index);
+        }
+        dirty.clear();
+    }
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        close(static_cast<uint32_t>(i), "server stopped");
+    }
+    logger.log("Server has stopped.");
+}
+
+// The listening socket is edge-triggered, so accept until the backlog is empty
+void TcpGateway::acceptSessions() {
+    Logger& logger = Logger::getInstance();
+    for (;;) {
+        sockaddr_in peer{};
+        socklen_t peerLength = sizeof(peer);
+        int fd = accept4(listenFd, reinterpret_cast<sockaddr*>(&peer), &peerLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                logger.log("Error: Failed to accept a TCP connection: " + std::string(std::strerror(errno)),
+                           LogLevel::Error);
+            }
+            return;
+        }
+        if (freeSessions.empty()) {
+            relaxedAdd(refused, 1);
+            logger.log("Refused TCP connection from " + describePeer(peer) + ": all " +
+                       std::to_string(sessions.size()) + " sessions in use", LogLevel::Warn);
+            ::close(fd);
+            continue;
+        }
+
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        const uint32_t index = freeSessions.back();
+        freeSessions.pop_back();
+        Session& session = sessions[index];
+        session.fd = fd;
+        session.inSequence = 0;
+        session.outSequence = 0;
+        session.readLength = 0;
+        session.writeStart = 0;
+        session.writeEnd = 0;
+        session.readable = false;
+        session.binary = false;
+        session.peer = peer;
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = index;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(index, "epoll registration failed");
+            continue;
+        }
+        relaxedAdd(accepted, 1);
+        active.store(sessions.size() - freeSessions.size(), std::memory_order_relaxed);
+        logger.log("TCP session " + std::to_string(index) + " opened from " + describePeer(peer));
+    }
+}
+
+bool TcpGateway::service(uint32_t index, OrderHandler& engine) {
+    Session& session = sessions[index];
+    bool executed = false;
+    for (;;) {
+        // Execute the complete frames while there is room for their replies
+        size_t offset = 0;
+        while (!session.closing && hasRoom(session) && network.running() &&
+               session.readLength - offset >= sizeof(TcpFrameHeader)) {
+            TcpFrameHeader header;
+            std::memcpy(&header, &session.readBuffer[offset], sizeof(header));
+            if (header.length == 0 || header.length > NetworkInterface::MAX_DATAGRAM) {
+                close(index, "bad frame length " + std::to_string(header.length));
+                return executed;
+            }
+            if (session.readLength - offset < sizeof(header) + header.length) {
+                break;
+            }
+            if (header.sequence != session.inSequence + 1) {
+                close(index, "expected sequence " + std::to_string(session.inSequence + 1) + ", got " +
+                                 std::to_string(header.sequence));
+                return executed;
+            }
+            session.inSequence = header.sequence;
+            std::memcpy(frame, &session.readBuffer[offset + sizeof(header)], header.length);
+            offset += sizeof(header) + header.length;
+            executeFrame(session, header.length, engine);
+            executed = true;
+        }
+        if (offset > 0) {
+            session.readLength -= offset;
+            std::memmove(session.readBuffer.data(), &session.readBuffer[offset], session.readLength);
+        }
+        // Full sessions resume once flush() has made room
+        if (session.closing || !hasRoom(session) || !session.readable || !network.running()) {
+            return executed;
+        }
+
+        ssize_t received = recv(session.fd, &session.readBuffer[session.readLength],
+                                session.readBuffer.size() - session.readLength, 0);
+        if (received > 0) {
+            session.readLength += static_cast<size_t>(received);
+        } else if (received == 0) {
+            close(index, "closed by peer");
+            return executed;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            session.readable = false;
+            return executed;
+        } else if (errno != EINTR) {
+            close(index, std::strerror(errno));
+            return executed;
+        }
+    }
+}
+
+// Runs one request through the same decode and execute steps as a datagram
+void TcpGateway::executeFrame(Session& session, size_t length, OrderHandler& engine) {
+    relaxedAdd(framesIn, 1);
+    session.binary = network.isBinary(frame, length);
+
+    size_t responseLength = 0;
+    if (!session.binary && isCommand(frame, length, "dropcopy")) {
+        if (!session.dropCopy) {
+            session.dropCopy = true;
+            dropCopies.push_back(indexOf(session));
+        }
+        static const char reply[] = "Drop copy enabled.";
+        appendFrame(session, reply, sizeof(reply) - 1);
+        return;
+    }
+
+    OrderMessage message;
+    current = &session;
+    if (network.decodeDatagram(frame, length, message, response, responseLength)) {
+        responseLength = network.executeMessage(message, frame, length, engine, response);
+    }
+    current = nullptr;
+    if (responseLength > 0) {
+        appendFrame(session, response, responseLength);
+    }
+}
+
+bool TcpGateway::appendFrame(Session& session, const char* data, size_t length) {
+    if (session.fd < 0 || session.closing) {
+        return false;
+    }
+    const size_t needed = sizeof(TcpFrameHeader) + length;
+    if (session.writeBuffer.size() - session.writeEnd < needed && session.writeStart > 0) {
+        session.writeEnd -= session.writeStart;
+        std::memmove(session.writeBuffer.data(), &session.writeBuffer[session.writeStart], session.writeEnd);
+        session.writeStart = 0;
+    }
+
+    const uint32_t index = indexOf(session);
+    if (!session.dirty) {
+        session.dirty = true;
+        dirty.push_back(index);
+    }
+    if (session.writeBuffer.size() - session.writeEnd < needed) {
+        session.closing = true;  // Not reading its replies; dropped after this pass
+        return false;
+    }
+
+    TcpFrameHeader header{static_cast<uint32_t>(length), ++session.outSequence};
+    std::memcpy(&session.writeBuffer[session.writeEnd], &header, sizeof(header));
+    std::memcpy(&session.writeBuffer[session.writeEnd + sizeof(header)], data, length);
+    session.writeEnd += needed;
+    relaxedAdd(framesOut, 1);
+    return true;
+}
+
+void TcpGateway::flush(uint32_t index) {
+    Session& session = sessions[index];
+    while (session.writeStart < session.writeEnd) {
+        ssize_t sent = send(session.fd, &session.writeBuffer[session.writeStart],
+                            session.writeEnd - session.writeStart, MSG_NOSIGNAL);
+        if (sent > 0) {
+            session.writeStart += static_cast<size_t>(sent);
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;  // EPOLLOUT resumes
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            close(index, "send failed");
+            return;
+        }
+    }
+    if (session.writeStart == session.writeEnd) {
+        session.writeStart = session.writeEnd = 0;
+    }
+    // Input held back for lack of room can go ahead now
+    if ((session.readable || session.readLength > 0) && hasRoom(session)) {
+        markPending(index);
+    }
+}
+
+void TcpGateway::markPending(uint32_t index) {
+    Session& session = sessions[index];
+    if (!session.pending) {
+        session.pending = true;
+        pending.push_back(index);
+    }
+}
+
+void TcpGateway::close(uint32_t index, const std::string& reason) {
+    Session& session = sessions[index];
+    if (session.fd < 0) {
+        return;
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+    ::close(session.fd);
+    session.fd = -1;
+
+    // Its resting orders stay on the book, but their executions have nowhere to go
+    while (session.owned) {
+        owners.erase(session.owned->orderId);
+        unlink(session.owned);
+    }
+    if (session.dropCopy) {
+        dropCopies.erase(std::find(dropCopies.begin(), dropCopies.end(), index));
+    }
+    session.pending = false;
+    session.dirty = false;
+    session.dropCopy = false;
+    session.closing = false;
+    freeSessions.push_back(index);
+    relaxedAdd(disconnected, 1);
+    active.store(sessions.size() - freeSessions.size(), std::memory_order_relaxed);
+    Logger::getInstance().log("TCP session " + std::to_string(index) + " from " + describePeer(session.peer) +
+                              " closed: " + reason);
+}
+
+void TcpGateway::onExecution(const OrderMessage& message, const ExecutionReport& report) {
+    if (report.queued) {
+        return;  // Matched on a shard thread; the outcome is not known here
+    }
+    const OrderId orderId = message.order.orderId;
+    switch (message.type) {
+        case MessageType::NewOrder:
+            if (current && report.openQuantity > 0 && ownedPool.available() > 0 && !owners.find(orderId)) {
+                Owned* owned = ownedPool.create(Owned{orderId, current, nullptr, current->owned});
+                if (current->owned) {
+                    current->owned->prev = owned;
+                }
+                current->owned = owned;
+                owners.insert(orderId, owned);
+            }
+            break;
+        case MessageType::Cancel:
+            release(orderId);
+            break;
+        case MessageType::Replace:
+            if (report.openQuantity == 0) {
+                release(orderId);
+            }
+            break;
+        case MessageType::Snapshot:
+            return;
+    }
+
+    const uint32_t symbolId = message.order.symbolId;
+    const char takerSide = report.side;
+    const char makerSide = takerSide == 'B' ? 'S' : 'B';
+    for (const Fill& fill : report.fills) {
+        if (Owned* owned = owners.find(fill.makerId)) {
+            sendExecution(*owned->session, fill, fill.makerId, fill.takerId, fill.makerRemaining, makerSide, symbolId);
+        }
+        if (fill.makerRemaining == 0) {
+            release(fill.makerId);
+        }
+        for (uint32_t index : dropCopies) {
+            Session& session = sessions[index];
+            sendExecution(session, fill, fill.takerId, fill.makerId, fill.takerRemaining, takerSide, symbolId);
+            sendExecution(session, fill, fill.makerId, fill.takerId, fill.makerRemaining, makerSide, symbolId);
+        }
+    }
+}
+
+void TcpGateway::sendExecution(Session& session, const Fill& fill, OrderId orderId, OrderId contraId, int remaining,
+                               char side, uint32_t symbolId) {
+    char execution[NetworkInterface::MAX_RESPONSE];
+    size_t length = network.writeExecution(fill, orderId, contraId, remaining, side, symbolId, session.binary,
+                                           execution);
+    if (appendFrame(session, execution, length)) {
+        relaxedAdd(executions, 1);
+    }
+}
+
+void TcpGateway::release(OrderId orderId) {
+    if (Owned* owned = owners.find(orderId)) {
+        owners.erase(orderId);
+        unlink(owned);
+    }
+}
+
+void TcpGateway::unlink(Owned* owned) {
+    if (owned->prev) {
+        owned->prev->next = owned->next;
+    } else {
+        owned->session->owned = owned->next;
+    }
+    if (owned->next) {
+        owned->next->prev = owned->prev;
+    }
+    ownedPool.destroy(owned);
+}
+
+std::string TcpGateway::report() const {
+    std::ostringstream oss;
+    oss << "tcp: active=" << active.load(std::memory_order_relaxed)
+        << " accepted=" << accepted.load(std::memory_order_relaxed)
+        << " refused=" << refused.load(std::memory_order_relaxed)
+        << " disconnected=" << disconnected.load(std::memory_order_relaxed)
+        << " slowConsumers=" << slowConsumers.load(std::memory_order_relaxed)
+        << " framesIn=" << framesIn.load(std::memory_order_relaxed)
+        << " framesOut=" << framesOut.load(std::memory_order_relaxed)
+        << " executions=" << executions.load(std::memory_order_relaxed) << "\n";
+    return oss.str();
+}
@@ -0,0 +1,141 @@
+#ifndef TCP_GATEWAY_H
+#define TCP_GATEWAY_H
+
+#include "NetworkInterface.h"
+#include "Message.h"
+#include "ObjectPool.h"
+#include "OrderIndex.h"
+#include "Protocol.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+
+// Sizing of the TCP order-entry gateway
+struct GatewayConfig {
+    int port = 0;
+    size_t maxSessions = 1024;          // Connections beyond this are refused
+    size_t writeBufferBytes = 32768;    // Per session; a session that falls this far behind is dropped
+    size_t maxOwnedOrders = 1 << 20;    // Resting orders whose executions are routed back to their session
+};
+
+// Order entry over TCP. Clients send the text or binary requests the UDP listener
+// takes, each framed by a TcpFrameHeader, and get their replies back on the same
+// connection. Sessions are served by one edge-triggered epoll loop on the network
+// thread, which also drains the UDP socket and polls any local transport, so the
+// engine keeps a single caller.
+//
+// Every session has a fixed read and write buffer, allocated with the session
+// table at startup. Frames read in one pass over the ready sessions are matched,
+// committed once and only then written back. When a session's write buffer has
+// no room for another reply its input is left unread until the buffer drains.
+//
+// Orders that rest are remembered against the session that entered them. When
+// one trades against a later order, from any transport, its session is sent a
+// WireExecution (or an "Execution: ..." line to a text session). A session that
+// sends "dropcopy" additionally receives both sides of every execution.
+class TcpGateway {
+private:
+    static constexpr size_t READ_BUFFER = 4096;  // Several frames of the largest request
+    static constexpr size_t MAX_FRAME = sizeof(TcpFrameHeader) + NetworkInterface::MAX_RESPONSE;
+
+    struct Owned;
+
+    struct Session {
+        int fd = -1;
+        uint32_t inSequence = 0;    // Last frame sequence received
+        uint32_t outSequence = 0;   // Last frame sequence sent
+        std::vector<char> readBuffer;
+        size_t readLength = 0;      // Bytes received and not yet consumed
+        std::vector<char> writeBuffer;
+        size_t writeStart = 0;      // Bytes before this have been sent
+        size_t writeEnd = 0;
+        Owned* owned = nullptr;     // Its resting orders in `owners`, newest first
+        bool readable = false;      // Input may be waiting in the socket (edge seen, EAGAIN not yet)
+        bool pending = false;       // On the pending list
+        bool dirty = false;         // On the dirty list
+        bool binary = false;        // Format of the last request, used for unsolicited executions
+        bool dropCopy = false;
+        bool closing = false;       // Closed once the current pass is done
+        sockaddr_in peer{};
+    };
+
+    // A resting order entered by a session, linked into that session's list so a
+    // disconnect releases only its own orders
+    struct Owned {
+        OrderId orderId;
+        Session* session;
+        Owned* prev;
+        Owned* next;
+    };
+
+    NetworkInterface& network;
+    GatewayConfig config;
+    int listenFd = -1;
+    int epollFd = -1;
+
+    std::vector<Session> sessions;
+    std::vector<uint32_t> freeSessions;
+    std::vector<uint32_t> pending;      // Sessions with input to process this pass
+    std::vector<uint32_t> dirty;        // Sessions with output to flush after the commit
+    std::vector<uint32_t> dropCopies;   // Sessions that asked for every execution
+
+    ObjectPool<Owned> ownedPool;
+    OrderIndex<Owned> owners;           // Resting order ID -> the session that entered it
+    Session* current = nullptr;         // Session whose request the engine is executing
+    char frame[NetworkInterface::MAX_DATAGRAM + 1];     // Request plus a terminator
+    char response[NetworkInterface::MAX_RESPONSE];
+
+    // Counters, written by the gateway thread only
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> refused{0};
+    std::atomic<uint64_t> disconnected{0};
+    std::atomic<uint64_t> slowConsumers{0};
+    std::atomic<uint64_t> framesIn{0};
+    std::atomic<uint64_t> framesOut{0};
+    std::atomic<uint64_t> executions{0};    // Unsolicited WireExecution frames, drop copies included
+    std::atomic<uint64_t> active{0};
+
+    void acceptSessions();
+    // Reads and executes frames until the socket is drained or the write buffer is
+    // full; returns true if anything was handed to the engine
+    bool service(uint32_t index, OrderHandler& engine);
+    void executeFrame(Session& session, size_t length, OrderHandler& engine);
+    void flush(uint32_t index);
+    void close(uint32_t index, const std::string& reason);
+
+    // Appends one framed message; false (and the session is dropped) if it does not fit
+    bool appendFrame(Session& session, const char* data, size_t length);
+    bool hasRoom(const Session& session) const {
+        return session.writeBuffer.size() - session.writeEnd + session.writeStart >= MAX_FRAME;
+    }
+    void markPending(uint32_t index);
+
+    // Execution listener: tracks resting orders and sends the unsolicited executions
+    void onExecution(const OrderMessage& message, const ExecutionReport& report);
+    void sendExecution(Session& session, const Fill& fill, OrderId orderId, OrderId contraId, int remaining,
+                       char side, uint32_t symbolId);
+    void release(OrderId orderId);
+    void unlink(Owned* owned);  // Takes it off its session's list and frees it
+
+    uint32_t indexOf(const Session& session) const { return static_cast<uint32_t>(&session - sessions.data()); }
+
+public:
+    // Binds and listens on config.port and preallocates every session. Registers
+    // itself as `network`'s execution listener.
+    TcpGateway(NetworkInterface& network, const GatewayConfig& config);
+    ~TcpGateway();
+
+    TcpGateway(const TcpGateway&) = delete;
+    TcpGateway& operator=(const TcpGateway&) = delete;
+
+    // Serves TCP sessions and UDP datagrams on the calling thread until the
+    // network interface is stopped
+    void run(OrderHandler& engine);
+
+    // Session and frame counters, for statsReport(); safe from any thread
+    std::string report() const;
+};
+
+#endif // TCP_GATEWAY_H
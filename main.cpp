@@ -2,50 +2,546 @@
 #include "Order.h"
 #include "NetworkInterface.h"
 #include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include "Pipeline.h"
+#include "TcpGateway.h"
+#include "ShmTransport.h"
+#include "Journal.h"
+#include "Replay.h"
+#include "RiskLimits.h"
+#include "Snapshot.h"
+#include "MarketData.h"
+#include "SymbolDirectory.h"
+#include "CpuAffinity.h"
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <memory>
 #include <thread>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Function to initialize critical components
-void initializeSystem(MatchingEngine& engine, NetworkInterface& network) {
+void initializeSystem(NetworkInterface& network) {
     Logger::getInstance().log("Initializing critical components...");
+    network.prepareSocket();  // Ensure the socket is ready
+    Logger::getInstance().log("Critical components initialized...");
+}
 
-    // Pre-warm the matching engine with a dummy order
-    Logger::getInstance().log("Pre-warming matching engine...");
-    Order dummyOrder(0, 'B', 0.0, 0, 0, 0, false);  // Dummy order
-    engine.processOrder(dummyOrder);
+// Command-line options
+struct Options {
+    BookCapacity capacity;
+    int64_t priceBand = 0;      // Ticks a market order may trade through the touch, 0 for no limit
+    std::string replayFile;     // Set: run this captured file through the engine offline and exit
+    std::string riskFile;       // Empty: no pre-trade risk checks
+    size_t riskTraders = 4096;  // Trader IDs 0 to this - 1 may trade when risk checks are on
+    bool asyncLog = false;
+    LogLevel logLevel = LogLevel::Info;
+    WireFormat wireFormat = WireFormat::Auto;
+    int port = 8080;
+    size_t batchSize = 1;
+    bool busyPoll = false;      // Spin on non-blocking receives instead of sleeping in recvfrom
+    int socketBusyPollUs = 0;   // SO_BUSY_POLL, 0 to leave the kernel default
+    int receiveBufferBytes = 0; // SO_RCVBUF, 0 to leave the kernel default
+    int networkCore = -1;       // CPU of the network thread (the receiver with --pipeline), -1 for none
+    int loggerCore = -1;        // CPU of the async log writer, -1 for none
+    int rtPriority = 0;         // SCHED_FIFO priority of the network, matching and pipeline threads, 0 for none
+    bool lockMemory = false;    // mlockall, so nothing the engine touches can be paged out
+    size_t warmupRequests = 20000; // Synthetic requests run on the network thread before serving, 0 for none
+    std::string symbolFile;     // Empty: a single default instrument
+    size_t shards = 0;          // 0: match inline on the network thread
+    std::vector<int> shardCores;
+    bool pipeline = false;      // Receive, parse, match and reply on separate threads
+    std::vector<int> pipelineCores;  // Parser, matcher, responder
+    size_t pipelineSlots = 4096;
+    GatewayConfig gateway;      // port 0: no TCP order entry
+    std::string shmName;        // Empty: no shared-memory order entry
+    size_t shmClients = 4;
+    size_t shmSlots = 256;      // Per ring
+    std::string journalFile;    // Empty: no journal
+    size_t journalMegabytes = 256;
+    bool journalSync = true;    // msync before replying
+    std::string snapshotDir;    // Empty: no snapshots
+    size_t snapshotEvery = 0;   // Journal records between automatic snapshots, 0 for none
+    bool marketData = false;    // Publish the L2 feed
+    MarketDataConfig marketDataConfig;
+};
 
-    // Pre-warm the network interface
-    Logger::getInstance().log("Pre-warming network interface...");
-    network.prepareSocket();  // Ensure the socket is ready
+// Parses a comma-separated list of CPU numbers
+std::vector<int> parseCores(const std::string& list) {
+    std::vector<int> cores;
+    std::istringstream ss(list);
+    std::string core;
+    while (std::getline(ss, core, ',')) {
+        cores.push_back(std::stoi(core));
+    }
+    return cores;
+}
 
-    Logger::getInstance().log("Critical components initialized...");
+Conflation parseConflation(const std::string& name) {
+    if (name == "message") return Conflation::Message;
+    if (name == "batch") return Conflation::Batch;
+    throw std::invalid_argument("Unknown conflation mode: " + name);
+}
+
+// Reads the options in a config file: the same options as the command line,
+// separated by whitespace or newlines; '#' starts a comment
+std::vector<std::string> readConfig(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open config file " + path);
+    }
+    std::vector<std::string> tokens;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream ss(line.substr(0, line.find('#')));
+        std::string token;
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+    }
+    return tokens;
+}
+
+WireFormat parseWireFormat(const std::string& name) {
+    if (name == "auto") return WireFormat::Auto;
+    if (name == "ascii") return WireFormat::Ascii;
+    if (name == "binary") return WireFormat::Binary;
+    throw std::invalid_argument("Unknown wire format: " + name);
+}
+
+// Reads --config <file> --port <n> --max-orders <n> --max-levels <n> --huge-pages --price-band <ticks>
+// --async-log --log-level <level> --wire-format <auto|ascii|binary> --batch-size <n> --busy-poll
+// --socket-busy-poll <us> --rcvbuf <bytes> --network-core <c> --logger-core <c> --rt-priority <1-99>
+// --risk-limits <file> --risk-traders <n> --replay <file>
+// --mlockall --warmup <requests> --symbols <file> --shards <n> --shard-cores <c0,c1,...> --pipeline --pipeline-slots <n>
+// --pipeline-cores <parser,matcher,responder> --tcp-port <n> --tcp-sessions <n> --tcp-write-buffer <bytes>
+// --shm-name <prefix> --shm-clients <n> --shm-slots <n>
+// --journal <file> --journal-size <megabytes>
+// --journal-no-sync --snapshot-dir <dir> --snapshot-every <records> --md-address <host:port>
+// --md-conflation <message|batch> --md-refresh-ms <ms>
+// A config file's options are read in place of --config, so later options override them.
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string arg = args[i];
+        auto hasValue = [&]() { return i + 1 < args.size(); };
+        if (arg == "--config" && hasValue()) {
+            std::vector<std::string> config = readConfig(args[i + 1]);
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            args.insert(args.begin() + i, config.begin(), config.end());
+            --i;  // Wraps, and the loop's increment brings it back to the file's first option
+        } else if (arg == "--port" && hasValue()) {
+            options.port = std::stoi(args[++i]);
+        } else if (arg == "--socket-busy-poll" && hasValue()) {
+            options.socketBusyPollUs = std::stoi(args[++i]);
+        } else if (arg == "--rcvbuf" && hasValue()) {
+            options.receiveBufferBytes = std::stoi(args[++i]);
+        } else if (arg == "--network-core" && hasValue()) {
+            options.networkCore = std::stoi(args[++i]);
+        } else if (arg == "--logger-core" && hasValue()) {
+            options.loggerCore = std::stoi(args[++i]);
+        } else if (arg == "--rt-priority" && hasValue()) {
+            options.rtPriority = std::stoi(args[++i]);
+            if (options.rtPriority < 1 || options.rtPriority > 99) {
+                throw std::invalid_argument("--rt-priority must be between 1 and 99");
+            }
+        } else if (arg == "--warmup" && hasValue()) {
+            options.warmupRequests = std::stoul(args[++i]);
+        } else if (arg == "--mlockall") {
+            options.lockMemory = true;
+        } else if (arg == "--pipeline-cores" && hasValue()) {
+            options.pipelineCores = parseCores(args[++i]);
+        } else if (arg == "--max-orders" && hasValue()) {
+            options.capacity.maxOrders = std::stoul(args[++i]);
+        } else if (arg == "--max-levels" && hasValue()) {
+            options.capacity.maxLevels = std::stoul(args[++i]);
+        } else if (arg == "--price-band" && hasValue()) {
+            options.priceBand = std::stoll(args[++i]);
+            if (options.priceBand < 0) {
+                throw std::invalid_argument("--price-band must not be negative");
+            }
+        } else if (arg == "--huge-pages") {
+            options.capacity.useHugePages = true;
+        } else if (arg == "--async-log") {
+            options.asyncLog = true;
+        } else if (arg == "--log-level" && hasValue()) {
+            options.logLevel = Logger::parseLevel(args[++i]);
+        } else if (arg == "--wire-format" && hasValue()) {
+            options.wireFormat = parseWireFormat(args[++i]);
+        } else if (arg == "--batch-size" && hasValue()) {
+            options.batchSize = std::stoul(args[++i]);
+        } else if (arg == "--busy-poll") {
+            options.busyPoll = true;
+        } else if (arg == "--symbols" && hasValue()) {
+            options.symbolFile = args[++i];
+        } else if (arg == "--shards" && hasValue()) {
+            options.shards = std::stoul(args[++i]);
+        } else if (arg == "--shard-cores" && hasValue()) {
+            options.shardCores = parseCores(args[++i]);
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--pipeline-slots" && hasValue()) {
+            options.pipelineSlots = std::stoul(args[++i]);
+        } else if (arg == "--tcp-port" && hasValue()) {
+            options.gateway.port = std::stoi(args[++i]);
+        } else if (arg == "--tcp-sessions" && hasValue()) {
+            options.gateway.maxSessions = std::stoul(args[++i]);
+        } else if (arg == "--tcp-write-buffer" && hasValue()) {
+            options.gateway.writeBufferBytes = std::stoul(args[++i]);
+        } else if (arg == "--shm-name" && hasValue()) {
+            options.shmName = args[++i];
+        } else if (arg == "--shm-clients" && hasValue()) {
+            options.shmClients = std::stoul(args[++i]);
+        } else if (arg == "--shm-slots" && hasValue()) {
+            options.shmSlots = std::stoul(args[++i]);
+        } else if (arg == "--replay" && hasValue()) {
+            options.replayFile = args[++i];
+        } else if (arg == "--risk-limits" && hasValue()) {
+            options.riskFile = args[++i];
+        } else if (arg == "--risk-traders" && hasValue()) {
+            options.riskTraders = std::stoul(args[++i]);
+        } else if (arg == "--journal" && hasValue()) {
+            options.journalFile = args[++i];
+        } else if (arg == "--journal-size" && hasValue()) {
+            options.journalMegabytes = std::stoul(args[++i]);
+        } else if (arg == "--journal-no-sync") {
+            options.journalSync = false;
+        } else if (arg == "--snapshot-dir" && hasValue()) {
+            options.snapshotDir = args[++i];
+        } else if (arg == "--snapshot-every" && hasValue()) {
+            options.snapshotEvery = std::stoul(args[++i]);
+        } else if (arg == "--md-address" && hasValue()) {
+            parseMarketDataAddress(args[++i], options.marketDataConfig);
+            options.marketData = true;
+        } else if (arg == "--md-conflation" && hasValue()) {
+            options.marketDataConfig.conflation = parseConflation(args[++i]);
+        } else if (arg == "--md-refresh-ms" && hasValue()) {
+            options.marketDataConfig.refreshMs = std::stoul(args[++i]);
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    if (!options.snapshotDir.empty() && options.journalFile.empty()) {
+        throw std::invalid_argument("--snapshot-dir needs --journal to replay what follows a snapshot");
+    }
+    if (options.snapshotEvery && options.snapshotDir.empty()) {
+        throw std::invalid_argument("--snapshot-every needs --snapshot-dir");
+    }
+    if (!options.replayFile.empty() && (options.shards > 0 || !options.journalFile.empty())) {
+        throw std::invalid_argument("--replay drives one engine without a journal; drop --shards and --journal");
+    }
+    if (!options.riskFile.empty() && options.shards > 0 && !options.journalFile.empty()) {
+        // Shards reject on their own threads, after the request has been journaled
+        throw std::invalid_argument("--risk-limits cannot be combined with both --shards and --journal");
+    }
+    if (options.gateway.port > 0 && options.pipeline) {
+        throw std::invalid_argument("--tcp-port cannot be combined with --pipeline");
+    }
+    if (!options.shmName.empty() && options.pipeline) {
+        throw std::invalid_argument("--shm-name cannot be combined with --pipeline");
+    }
+    if (!options.shmName.empty()) {
+        options.busyPoll = true;  // The rings are polled between receives, which must not block
+    }
+    return options;
+}
+
+// Describes a CPU, or a list of them, for the startup report
+std::string describeCore(int core) {
+    return core >= 0 ? std::to_string(core) : "unpinned";
+}
+
+std::string describeCores(const std::vector<int>& cores) {
+    if (cores.empty()) {
+        return "unpinned";
+    }
+    std::string list;
+    for (int core : cores) {
+        list += (list.empty() ? "" : ",") + describeCore(core);
+    }
+    return list;
+}
+
+// The thread, socket and memory settings in effect, with the measured cost of
+// idling, so a run's log records how it was placed
+std::string runtimeReport(const Options& options, const NetworkInterface& network, bool memoryLocked) {
+    std::ostringstream oss;
+    double spinNs = measureSpinNs();
+    oss << std::fixed << std::setprecision(1) << "Runtime settings:\n"
+        << "  port " << network.getPort()
+        << (options.gateway.port > 0 ? ", TCP port " + std::to_string(options.gateway.port) + " for " +
+                                           std::to_string(options.gateway.maxSessions) + " sessions"
+                                     : std::string())
+        << (options.shmName.empty() ? std::string()
+                                    : ", shared memory /" + options.shmName + ".0-" +
+                                          std::to_string(options.shmClients - 1))
+        << ", batch " << network.getBatchSize() << ", "
+        << (network.getBusyPoll() ? "busy-poll receive" : "blocking receive") << "\n"
+        << "  SO_BUSY_POLL " << network.socketBusyPollMicroseconds() << " us, SO_RCVBUF "
+        << network.receiveBufferBytes() << " bytes\n"
+        << "  network core " << describeCore(options.networkCore)
+        << ", logger core " << (options.asyncLog ? describeCore(options.loggerCore) : std::string("synchronous"));
+    if (options.shards > 0) {
+        oss << ", shard cores " << describeCores(options.shardCores);
+    }
+    if (options.pipeline) {
+        oss << ", pipeline cores " << describeCores(options.pipelineCores);
+    }
+    oss << "\n  realtime priority " << (options.rtPriority > 0 ? "SCHED_FIFO " + std::to_string(options.rtPriority)
+                                                                : std::string("off"))
+        << ", memory " << (memoryLocked ? "locked" : "not locked") << "\n"
+        << "  risk checks " << (options.riskFile.empty() ? std::string("off")
+                                                         : options.riskFile + " for " +
+                                                               std::to_string(options.riskTraders) + " traders")
+        << "\n"
+        << "  idle spin " << spinNs << " ns per pause, " << SPINS_BEFORE_YIELD * spinNs / 1000.0
+        << " us before an idle thread yields; empty poll " << network.measureEmptyPollNs() << " ns";
+    return oss.str();
+}
+
+// Runs the warm-up stream through the network interface on the calling thread,
+// matched by a throwaway engine with the same instruments, so the live books are
+// untouched. Logging is off meanwhile, as the requests are not real.
+void warmUp(NetworkInterface& network, const Options& options, size_t symbolCount,
+            const std::vector<LadderConfig>& ladders) {
+    Logger& logger = Logger::getInstance();
+    logger.prepareThread();
+    if (options.warmupRequests == 0) {
+        return;
+    }
+
+    const LogLevel level = logger.getLevel();
+    logger.setLevel(LogLevel::Off);
+    std::string summary;
+    {
+        BookCapacity capacity;
+        capacity.maxOrders = options.warmupRequests;
+        capacity.maxLevels = std::max<size_t>(options.warmupRequests, 16);
+        MatchingEngine scratch(capacity, symbolCount, ladders);
+        scratch.setPriceBand(options.priceBand);
+        summary = network.warmUp(scratch, options.warmupRequests);
+    }
+    logger.setLevel(level);
+    logger.log(summary);
 }
 
-int main() {
+// Runs a captured request file through a fresh engine configured as the live one
+// would be, on the calling thread placed like the network thread, and logs the
+// throughput, latencies and digests. No socket is opened. The max-rate limit is
+// not checked, as it would depend on how fast this machine replays.
+void replayFile(const Options& options, const SymbolDirectory& symbols, const std::vector<LadderConfig>& ladders,
+                const RiskLimits* riskLimits, const std::vector<double>& tickSizes) {
+    if (options.networkCore >= 0 || options.rtPriority > 0) {
+        Logger::getInstance().log("Replay thread " + placeCurrentThread(options.networkCore, options.rtPriority));
+    }
+    MatchingEngine engine(options.capacity, symbols.size(), ladders);
+    engine.setPriceBand(options.priceBand);
+    if (riskLimits) {
+        engine.enableRisk(*riskLimits, tickSizes, false);
+    }
+    NetworkInterface decoder(-1, symbols);
+    decoder.setWireFormat(options.wireFormat);
+
+    FileReplay replay(options.replayFile);
+    replay.run(decoder, engine);
+    Logger::getInstance().log(replay.report() + engine.statsReport());
+}
+
+int main(int argc, char* argv[]) {
     try {
         Logger::getInstance().log("Starting the Order Matching System...");
 
-        MatchingEngine engine;
-        NetworkInterface network(8080);
+        Options options = parseOptions(argc, argv);
+        Logger::getInstance().setLevel(options.logLevel);
+        if (options.asyncLog) {
+            Logger::getInstance().startAsync(options.loggerCore);
+        }
 
-        Logger::getInstance().log("Initializing network interface on port 8080...");
+        // Locks the pools as they are mapped, and everything allocated after them
+        bool memoryLocked = false;
+        if (options.lockMemory) {
+            memoryLocked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+            if (!memoryLocked) {
+                Logger::getInstance().log("Failed to lock memory; needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK",
+                                          LogLevel::Warn);
+            }
+        }
 
-        // Initialize critical components
-        initializeSystem(engine, network);
+        SymbolDirectory symbols = options.symbolFile.empty() ? SymbolDirectory::singleInstrument()
+                                                             : SymbolDirectory::load(options.symbolFile);
+        Logger::getInstance().log("Loaded " + std::to_string(symbols.size()) + " instruments");
+
+        // Books of instruments with a ladder keep the levels near their reference price in an array
+        std::vector<LadderConfig> ladders(symbols.size());
+        for (uint32_t symbolId = 0; symbolId < symbols.size(); ++symbolId) {
+            const Instrument& instrument = symbols.at(symbolId);
+            ladders[symbolId] = LadderConfig{instrument.ladderLow, instrument.ladderTicks};
+        }
+
+        // Limits are read once here and again on "risk reload"; positions are counted from startup
+        std::unique_ptr<RiskLimits> riskLimits;
+        std::vector<double> tickSizes(symbols.size());
+        if (!options.riskFile.empty()) {
+            riskLimits = std::make_unique<RiskLimits>(options.riskFile, options.riskTraders);
+            for (uint32_t symbolId = 0; symbolId < symbols.size(); ++symbolId) {
+                tickSizes[symbolId] = symbols.at(symbolId).tickSize;
+            }
+            Logger::getInstance().log("Risk limits from " + options.riskFile);
+        }
+
+        if (!options.replayFile.empty()) {
+            replayFile(options, symbols, ladders, riskLimits.get(), tickSizes);
+            Logger::getInstance().stopAsync();
+            return 0;
+        }
+
+        // Either match inline on the network thread, or hand orders to sharded matching threads.
+        // With snapshots, the books start from the newest complete one.
+        const uint32_t parts = options.shards > 0 ? static_cast<uint32_t>(options.shards) : 1;
+        const uint64_t snapshotSequence = options.snapshotDir.empty() ? 0 : latestSnapshot(options.snapshotDir, parts);
+        auto restore = [&](auto& matcher) {
+            if (options.snapshotDir.empty()) {
+                return;
+            }
+            mkdir(options.snapshotDir.c_str(), 0755);
+            matcher.enableSnapshots(options.snapshotDir);
+            if (snapshotSequence) {
+                matcher.loadSnapshot(snapshotSequence);
+            }
+        };
 
-       
+        std::unique_ptr<OrderHandler> engine;
+        std::function<void()> startMarketData;
+        if (options.shards > 0) {
+            auto sharded = std::make_unique<ShardedEngine>(options.shards, options.capacity, symbols.size(),
+                                                           options.shardCores, options.rtPriority, ladders);
+            sharded->setPriceBand(options.priceBand);
+            if (riskLimits) {
+                sharded->enableRisk(*riskLimits, tickSizes);
+            }
+            restore(*sharded);
+            startMarketData = [&options, s = sharded.get()]() { s->enableMarketData(options.marketDataConfig); };
+            engine = std::move(sharded);
+            Logger::getInstance().log("Matching on " + std::to_string(options.shards) + " shard threads");
+        } else {
+            auto matcher = std::make_unique<MatchingEngine>(options.capacity, symbols.size(), ladders);
+            matcher->setPriceBand(options.priceBand);
+            if (riskLimits) {
+                matcher->enableRisk(*riskLimits, tickSizes);
+            }
+            restore(*matcher);
+            startMarketData = [&options, m = matcher.get()]() { m->enableMarketData(options.marketDataConfig); };
+            engine = std::move(matcher);
+        }
+
+        // Replay the journal after the snapshot, then journal everything the network hands over
+        std::unique_ptr<Journal> journal;
+        std::unique_ptr<OrderHandler> journaled;
+        if (!options.journalFile.empty()) {
+            journal = std::make_unique<Journal>(options.journalFile, options.journalMegabytes << 20,
+                                                options.journalSync);
+            journal->replay(*engine, snapshotSequence);
+            journaled = std::make_unique<JournaledHandler>(*engine, *journal, options.snapshotEvery);
+        }
+        OrderHandler& handler = journaled ? *journaled : *engine;
+
+        // Started after recovery so replayed trades are not published again; the
+        // first refresh carries the recovered books to subscribers
+        if (options.marketData) {
+            startMarketData();
+            const MarketDataConfig& md = options.marketDataConfig;
+            Logger::getInstance().log("Market data on " + md.address + ":" + std::to_string(md.port) +
+                                      ", refresh on port " + std::to_string(md.port + 1));
+        }
+
+        NetworkInterface network(options.port, symbols);
+        network.setWireFormat(options.wireFormat);
+        network.setBatchSize(options.batchSize);
+        network.setBusyPoll(options.busyPoll);
+        if (options.receiveBufferBytes > 0 && !network.setReceiveBuffer(options.receiveBufferBytes)) {
+            Logger::getInstance().log("Failed to set SO_RCVBUF", LogLevel::Warn);
+        }
+        if (options.socketBusyPollUs > 0 && !network.setSocketBusyPoll(options.socketBusyPollUs)) {
+            Logger::getInstance().log("Failed to set SO_BUSY_POLL; raising it needs CAP_NET_ADMIN", LogLevel::Warn);
+        }
+
+        Logger::getInstance().log("Initializing network interface on port " + std::to_string(options.port) + "...");
+
+        // Initialize critical components
+        initializeSystem(network);
 
-        // Run network interface in a separate thread
+        // Run network interface in a separate thread, either handling each datagram
+        // start to finish or as the receiver stage of a pipeline
+        std::unique_ptr<OrderPipeline> pipeline;
+        if (options.pipeline) {
+            pipeline = std::make_unique<OrderPipeline>(network, options.pipelineSlots);
+            pipeline->setPlacement(options.pipelineCores, options.rtPriority);
+            Logger::getInstance().log("Pipelined network interface with " +
+                                      std::to_string(options.pipelineSlots) + " slots");
+        }
+        // Or serve TCP sessions too, on the same thread, from one epoll loop
+        std::unique_ptr<TcpGateway> gateway;
+        if (options.gateway.port > 0) {
+            GatewayConfig config = options.gateway;
+            config.maxOwnedOrders = options.capacity.maxOrders;
+            gateway = std::make_unique<TcpGateway>(network, config);
+            Logger::getInstance().log("TCP order entry on port " + std::to_string(config.port));
+        }
+        // Local clients' rings are polled by whichever loop serves the socket
+        std::unique_ptr<ShmTransport> shm;
+        if (!options.shmName.empty()) {
+            shm = std::make_unique<ShmTransport>(network, options.shmName, options.shmClients, options.shmSlots);
+            network.setLocalTransport([&shm](OrderHandler& engine) { return shm->poll(engine); });
+            Logger::getInstance().log("Shared-memory order entry for " + std::to_string(options.shmClients) +
+                                      " clients at /" + options.shmName + ".<n>");
+        }
+        network.addStatsSource([&handler]() { return handler.statsReport(); });
+        if (pipeline) {
+            network.addStatsSource([&pipeline]() { return pipeline->report(); });
+        }
+        if (gateway) {
+            network.addStatsSource([&gateway]() { return gateway->report(); });
+        }
+        if (shm) {
+            network.addStatsSource([&shm]() { return shm->report(); });
+        }
+        if (riskLimits) {
+            network.addCommand("risk reload", [&riskLimits]() {
+                riskLimits->reload();
+                Logger::getInstance().log("Risk limits reloaded from " + riskLimits->file());
+                return "Risk limits reloaded.";
+            });
+        }
+        Logger::getInstance().log(runtimeReport(options, network, memoryLocked));
         std::thread networkThread([&]() {
-            network.receiveOrders(engine);
+            if (options.networkCore >= 0 || options.rtPriority > 0) {
+                Logger::getInstance().log("Network thread " +
+                                          placeCurrentThread(options.networkCore, options.rtPriority));
+            }
+            warmUp(network, options, symbols.size(), ladders);
+            if (pipeline) {
+                pipeline->run(handler);
+            } else if (gateway) {
+                gateway->run(handler);
+            } else {
+                network.receiveOrders(handler);
+            }
         });
 
         networkThread.join();
+        Logger::getInstance().log("Statistics:\n" + network.statsReport());
+        journaled.reset();
+        engine.reset();  // Sharded engines finish their queues before this returns
+        journal.reset();
 
+        Logger::getInstance().stopAsync();
         Logger::getInstance().log("Shutting down the system.");
         return 0;
     } catch (const std::exception& e) {
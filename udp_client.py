@@ -1,10 +1,195 @@
+import mmap
+import os
 import socket
+import struct
 
 # UDP client setup
 SERVER_ADDRESS = ("127.0.0.1", 8080)  # Server IP and port
-BUFFER_SIZE = 1024
+BUFFER_SIZE = 2048
+
+# Order format: <orderId> <side> <price> <quantity> <timestamp> <traderId> <isMarketOrder> [DAY|IOC|FOK] [symbol]
+# Cancel format: C <orderId> [symbol]
+# Replace format: R <orderId> <price> <quantity> [symbol]
+# Without a symbol, the first instrument of the engine's symbol file is used.
+
+# Binary protocol (see Protocol.h): packed little-endian, prices in ticks
+PROTOCOL_MAGIC = 0x4FA5
+PROTOCOL_VERSION = 4
+MSG_NEW_ORDER, MSG_CANCEL, MSG_REPLACE, MSG_ACK, MSG_EXECUTION = 1, 2, 3, 4, 5
+HEADER_FORMAT = "<HBBIQ"             # magic, version, type, symbolId, sequence
+NEW_ORDER_FORMAT = HEADER_FORMAT + "qqqiicBBB"
+CANCEL_FORMAT = HEADER_FORMAT + "q"
+REPLACE_FORMAT = HEADER_FORMAT + "qqi"
+ACK_FORMAT = HEADER_FORMAT + "qiHBB"     # orderId, openQuantity, fillCount, accepted, flags
+FILL_FORMAT = "<qqiii"               # makerId, price, quantity, takerRemaining, makerRemaining
+EXECUTION_FORMAT = HEADER_FORMAT + "qqqiic3x"  # orderId, contraId, price, quantity, remaining, side
+ACK_QUEUED, ACK_TRUNCATED, ACK_CANCELLED = 1, 2, 4
+
+# TCP order entry (--tcp-port): every message in either direction is framed
+FRAME_FORMAT = "<II"                 # length of the message that follows, per-session sequence from 1
+TIF_DAY, TIF_IOC, TIF_FOK = 0, 1, 2
+
+# Market data feed (see MarketData.h): incrementals on --md-address, refreshes on its port + 1
+MD_MAGIC = 0x4DA5
+MD_INCREMENTAL, MD_REFRESH = 1, 2
+MD_LEVEL, MD_TRADE = 1, 2
+MD_LAST_PACKET = 1
+MD_HEADER_FORMAT = "<HBBHHQB7x"      # magic, version, type, streamId, count, sequence, flags
+MD_ENTRY_FORMAT = "<BcHIqq"          # kind, side, reserved, symbolId, price, quantity
+
+
+def encode_new_order(seq, order_id, side, price_ticks, quantity, timestamp, trader_id, is_market=0, symbol_id=0,
+                     tif=TIF_DAY):
+    return struct.pack(NEW_ORDER_FORMAT, PROTOCOL_MAGIC, PROTOCOL_VERSION, MSG_NEW_ORDER, symbol_id, seq,
+                       order_id, price_ticks, timestamp, quantity, trader_id, side.encode(), is_market, tif, 0)
+
+
+def encode_cancel(seq, order_id, symbol_id=0):
+    return struct.pack(CANCEL_FORMAT, PROTOCOL_MAGIC, PROTOCOL_VERSION, MSG_CANCEL, symbol_id, seq, order_id)
+
+
+def encode_replace(seq, order_id, price_ticks, quantity, symbol_id=0):
+    return struct.pack(REPLACE_FORMAT, PROTOCOL_MAGIC, PROTOCOL_VERSION, MSG_REPLACE, symbol_id, seq,
+                       order_id, price_ticks, quantity)
+
+
+def decode_ack(data):
+    """Return (sequence, order_id, accepted, open_quantity, fills) from a binary acknowledgement.
+
+    Each fill is (maker_id, price_ticks, quantity, taker_remaining, maker_remaining).
+    """
+    ack_size = struct.calcsize(ACK_FORMAT)
+    fill_size = struct.calcsize(FILL_FORMAT)
+    _, _, _, _, seq, order_id, open_quantity, fill_count, accepted, _ = struct.unpack(ACK_FORMAT, data[:ack_size])
+    fills = [struct.unpack_from(FILL_FORMAT, data, ack_size + i * fill_size) for i in range(fill_count)]
+    return seq, order_id, bool(accepted), open_quantity, fills
+
+
+def decode_execution(data):
+    """Return (order_id, contra_id, price_ticks, quantity, remaining, side) from a WireExecution."""
+    fields = struct.unpack(EXECUTION_FORMAT, data[:struct.calcsize(EXECUTION_FORMAT)])
+    order_id, contra_id, price, quantity, remaining, side = fields[5:]
+    return order_id, contra_id, price, quantity, remaining, side.decode()
+
+
+class TcpSession:
+    """One order-entry session over TCP. Sends framed text or binary requests and
+    reads framed messages: replies, and executions of the session's resting orders."""
+
+    def __init__(self, address=("127.0.0.1", 9000)):
+        self.sock = socket.create_connection(address)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.sent = 0
+        self.received = 0
+        self.pending = b""
+
+    def send(self, message):
+        if isinstance(message, str):
+            message = message.encode()
+        self.sent += 1
+        self.sock.sendall(struct.pack(FRAME_FORMAT, len(message), self.sent) + message)
+
+    def receive(self):
+        """Return the next message; raises if the server skipped a sequence number."""
+        header_size = struct.calcsize(FRAME_FORMAT)
+        while True:
+            if len(self.pending) >= header_size:
+                length, seq = struct.unpack_from(FRAME_FORMAT, self.pending)
+                if len(self.pending) >= header_size + length:
+                    message = self.pending[header_size:header_size + length]
+                    self.pending = self.pending[header_size + length:]
+                    self.received += 1
+                    if seq != self.received:
+                        raise RuntimeError(f"Expected frame {self.received}, got {seq}")
+                    return message
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("Session closed by the server")
+            self.pending += data
+
+    def close(self):
+        self.sock.close()
+
+
+# Shared-memory order entry (--shm-name): see ShmChannel.h for the segment layout
+SHM_MAGIC = 0x4D485341
+SHM_SLOT_SIZE = 2048
+SHM_CHANNEL_FORMAT = "<IHHIII"        # magic, version, reserved, slotCount, slotSize, owner
+
+
+class ShmSession:
+    """One shared-memory channel of an engine started with --shm-name <prefix>.
+    Claims the first free channel by writing its process ID as the owner, which
+    unlike ShmClient.h is not atomic: start Python clients one at a time."""
+
+    def __init__(self, prefix="matching"):
+        index = 0
+        while True:
+            path = f"/dev/shm/{prefix}.{index}"
+            if not os.path.exists(path):
+                raise RuntimeError(f"No free shared-memory channel for {prefix}")
+            with open(path, "r+b") as f:
+                self.shm = mmap.mmap(f.fileno(), 0)
+            magic, _, _, slots, _, owner = struct.unpack_from(SHM_CHANNEL_FORMAT, self.shm)
+            if magic == SHM_MAGIC and owner == 0:
+                break
+            self.shm.close()
+            index += 1
+        struct.pack_into("<I", self.shm, 16, os.getpid())
+        self.slots = slots
+        self.requests = 64                                  # Ring header offsets
+        self.responses = 192 + slots * SHM_SLOT_SIZE
+        # Skip replies meant for an earlier client
+        struct.pack_into("<Q", self.shm, self.responses + 64, self._cursor(self.responses))
+
+    def _cursor(self, offset):
+        return struct.unpack_from("<Q", self.shm, offset)[0]
+
+    def _slot(self, ring, position):
+        return ring + 128 + (position % self.slots) * SHM_SLOT_SIZE
+
+    def send(self, message):
+        if isinstance(message, str):
+            message = message.encode()
+        head = self._cursor(self.requests)
+        while head - self._cursor(self.requests + 64) >= self.slots:
+            pass                                            # Ring full
+        slot = self._slot(self.requests, head)
+        struct.pack_into("<I", self.shm, slot, len(message))
+        self.shm[slot + 4:slot + 4 + len(message)] = message
+        struct.pack_into("<Q", self.shm, self.requests, head + 1)
+
+    def receive(self):
+        """Spin until the next reply arrives and return it."""
+        tail = self._cursor(self.responses + 64)
+        while self._cursor(self.responses) == tail:
+            pass
+        slot = self._slot(self.responses, tail)
+        length = struct.unpack_from("<I", self.shm, slot)[0]
+        message = self.shm[slot + 4:slot + 4 + length]
+        struct.pack_into("<Q", self.shm, self.responses + 64, tail + 1)
+        return message
+
+    def close(self):
+        struct.pack_into("<I", self.shm, 16, 0)
+        self.shm.close()
+
+
+def decode_market_data(data):
+    """Return (type, stream_id, sequence, last, entries) from a market data packet.
+
+    Each entry is (kind, side, symbol_id, price_ticks, quantity); a level with quantity 0 was removed.
+    """
+    header_size = struct.calcsize(MD_HEADER_FORMAT)
+    entry_size = struct.calcsize(MD_ENTRY_FORMAT)
+    _, _, md_type, stream_id, count, seq, flags = struct.unpack(MD_HEADER_FORMAT, data[:header_size])
+    entries = []
+    for i in range(count):
+        kind, side, _, symbol_id, price, quantity = struct.unpack_from(MD_ENTRY_FORMAT, data, header_size + i * entry_size)
+        entries.append((kind, side.decode(), symbol_id, price, quantity))
+    return md_type, stream_id, seq, bool(flags & MD_LAST_PACKET), entries
+
 
-# Order format: <orderId> <side> <price> <quantity> <timestamp> <traderId> <isMarketOrder>
 def send_order(order):
     """Send an order to the matching engine and receive a response."""
     with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
@@ -22,6 +207,22 @@ def send_order(order):
             return f"Error: {e}"
 
 
+def send_binary(message):
+    """Send a binary message and return the decoded acknowledgement."""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        try:
+            sock.sendto(message, SERVER_ADDRESS)
+            response, _ = sock.recvfrom(BUFFER_SIZE)
+            ack = decode_ack(response)
+            print(f"Binary ack: seq={ack[0]} orderId={ack[1]} accepted={ack[2]} open={ack[3]}")
+            for maker_id, price, quantity, taker_remaining, _ in ack[4]:
+                print(f"  Fill: maker={maker_id} price={price} quantity={quantity} remaining={taker_remaining}")
+            return ack
+        except Exception as e:
+            print(f"Error while sending binary message: {e}")
+            return None
+
+
 # Test Cases
 def generate_test_cases():
     """Generate test cases covering all scenarios."""
@@ -59,6 +260,14 @@ def generate_test_cases():
         "22 B 100.123456789 1 169348143 2019 0",  # High-precision price
         "23 S 9999999999.99 10 169348144 2020 0", # Very large price
         "24 B 100.00 999999 169348145 2021 0",    # Very large quantity
+
+        # Cancel and Replace
+        "25 S 105.00 10 169348146 2022 0",   # Resting order to amend/cancel
+        "R 25 105.00 6",                     # Quantity-down amend (keeps priority)
+        "R 25 104.00 6",                     # Price change (loses priority)
+        "C 25",                              # Cancel
+        "C 25",                              # Cancel of unknown order
+        "R 999 100.00 5",                    # Replace of unknown order
     ]
 
 
@@ -74,10 +283,23 @@ def run_test_cases():
     print("\n--- Test Cases Completed ---")
 
 
+def run_binary_test_cases():
+    """Exercise the binary protocol: add, amend, cancel and a rejected order."""
+    print("\n--- Running Binary Test Cases ---\n")
+    send_binary(encode_new_order(1, 101, "S", 10500, 10, 169348150, 3001))
+    send_binary(encode_replace(2, 101, 10500, 4))
+    send_binary(encode_new_order(3, 102, "B", 10500, 2, 169348151, 3002))
+    send_binary(encode_cancel(4, 101))
+    send_binary(encode_new_order(5, 103, "X", 10500, 1, 169348152, 3003))  # Invalid side
+    send_binary(encode_new_order(6, 104, "B", 10500, 5, 169348153, 3004, tif=TIF_IOC))  # Nothing to trade, cancelled
+    print("\n--- Binary Test Cases Completed ---")
+
+
 def interactive_mode():
     """Allow the user to place additional orders interactively."""
     print("\n--- Enter Interactive Mode ---")
-    print("Type your orders in the format: <orderId> <side> <price> <quantity> <timestamp> <traderId> <isMarketOrder>")
+    print("Type your orders in the format: <orderId> <side> <price> <quantity> <timestamp> <traderId> <isMarketOrder> [DAY|IOC|FOK] [symbol]")
+    print("Cancel with 'C <orderId> [symbol]', replace with 'R <orderId> <price> <quantity> [symbol]'")
     print("Type 'exit' to quit and shut down the server.\n")
 
     while True:
@@ -101,6 +323,7 @@ if __name__ == "__main__":
 
     # Run the predefined test cases
     run_test_cases()
+    run_binary_test_cases()
 
     # Enter interactive mode for additional orders
     interactive_mode()